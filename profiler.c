@@ -7,10 +7,113 @@
  */
 
 #include <sys/wait.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
+#include <signal.h>
+#include <getopt.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <limits.h>
 #include <stdio.h>
+#include <time.h>
+
+#define BINMAGIC	"PROFBIN"
+#define BINVERSION	1
+#define SHMMAGIC	"PROFSHM"
+#define SHMVERSION	1
+#define SHMCHUNKS	128
+#define SHMMAPS		65536
+#define EVENTMAX	4
+
+typedef struct
+{
+	char magic[8];
+	unsigned int version;
+	unsigned int size;
+	unsigned int callersize;
+	unsigned int funcsize;
+	unsigned long long callers;
+	unsigned long long funcs;
+	unsigned long long maps;
+	unsigned long long calleroff;
+	unsigned long long funcoff;
+	unsigned long long mapoff;
+	unsigned long long textoff;
+} BINHDR;
+
+typedef struct
+{
+	unsigned long long func;
+	unsigned long long caller;
+	unsigned long long calls;
+	unsigned long long nsecs;
+	unsigned long long calling;
+	unsigned long long unwind;
+	unsigned long long overhead;
+	unsigned long long incl;
+	unsigned long long incloverhead;
+	unsigned long long incltrans;
+	unsigned long long wall;
+} BINCALLER;
+
+typedef struct
+{
+	unsigned long long func;
+	unsigned long long calls;
+	unsigned long long nsecs;
+	unsigned long long funcs;
+	unsigned long long overhead;
+	unsigned int unwind;
+	unsigned int depth;
+} BINFUNC;
+
+typedef struct
+{
+	unsigned long long start;
+	unsigned long long end;
+	unsigned int size;
+	unsigned int len;
+	char file[0];
+} BINMAP;
+
+typedef struct
+{
+	unsigned long long offset;
+	unsigned long long size;
+	int pool;
+	int pad;
+} SHMCHUNK;
+
+typedef struct
+{
+	char magic[8];
+	unsigned int version;
+	unsigned int size;
+	int pid;
+	int done;
+	int chunks;
+	unsigned int chunkdata;
+	unsigned int chunksize;
+	unsigned int chunkused;
+	unsigned int funcsize;
+	unsigned int callersize;
+	unsigned int callerfunc;
+	unsigned int callercaller;
+	unsigned int callercalls;
+	unsigned int callertime;
+	unsigned int calleroverhead;
+	unsigned int pad;
+	unsigned long long filesize;
+	unsigned long long clockfreq;
+	unsigned long long overhead;
+	char clock[16];
+	SHMCHUNK chunk[SHMCHUNKS];
+	char maps[SHMMAPS];
+} SHMHDR;
 
 typedef struct map
 {
@@ -43,6 +146,12 @@ typedef struct trace
 	unsigned long long nsecs;
 	unsigned long long calling;
 	unsigned long long unwind;
+	unsigned long long overhead;
+	unsigned long long incl;
+	unsigned long long incloverhead;
+	unsigned long long incltrans;
+	unsigned long long wall;
+	unsigned long long offcpu;
 	int funcid;
 	int callerid;
 } TRACE;
@@ -58,6 +167,7 @@ typedef struct thread
 	unsigned long long funcs;
 	unsigned long long unwind;
 	unsigned long long depth;
+	unsigned long long overhead;
 	unsigned long long avg;
 } THREAD;
 
@@ -69,8 +179,105 @@ typedef struct
 	unsigned long long calls;
 	unsigned long long nsecs;
 	unsigned long long avg;
+	unsigned long long incl;
+	unsigned long long avgincl;
+	unsigned long long wall;
+	unsigned long long offcpu;
+	unsigned long long avgoff;
+	unsigned long long unwind;
+	unsigned long long events[EVENTMAX];
+	double key;
+	unsigned long long allocs;
+	unsigned long long frees;
+	unsigned long long bytes;
+	unsigned long long atime;
 } FUNC;
 
+typedef struct event
+{
+	struct event *next;
+	unsigned long func;
+	unsigned long long value[EVENTMAX];
+} EVENT;
+
+typedef struct heap
+{
+	struct heap *next;
+	unsigned long func;
+	unsigned long long allocs;
+	unsigned long long frees;
+	unsigned long long bytes;
+	unsigned long long time;
+} HEAP;
+
+typedef struct hist
+{
+	struct hist *next;
+	ADDR *funcdata;
+	MAP *funcmap;
+	unsigned long func;
+	unsigned long long total;
+	unsigned long long max;
+	unsigned long long pct[5];
+	unsigned long long count[0];
+} HIST;
+
+typedef struct
+{
+	ADDR *funcdata;
+	MAP *funcmap;
+	unsigned long func;
+	unsigned long long calls;
+	unsigned long long nsecs;
+	unsigned long long dcalls;
+	unsigned long long dnsecs;
+} LIVE;
+
+typedef struct
+{
+	int id;
+	unsigned long long calls;
+	unsigned long long nsecs;
+} ELEM;
+
+typedef struct node
+{
+	struct node *next;
+	struct node *parent;
+	struct node *child;
+	struct node *sibling;
+	ADDR *funcdata;
+	MAP *funcmap;
+	unsigned long func;
+	unsigned long long calls;
+	unsigned long long nsecs;
+	unsigned long long total;
+	unsigned long long calling;
+	unsigned long long unwind;
+	unsigned long long overhead;
+	int thread;
+	int id;
+	int parentid;
+} NODE;
+
+typedef struct task
+{
+	struct task *next;
+	int id;
+	int tid;
+	unsigned long long calls;
+	unsigned long long funcs;
+	unsigned long long nsecs;
+	unsigned long long overhead;
+	unsigned long long unwind;
+	unsigned long long depth;
+	unsigned long long lifetime;
+	unsigned long long maxtime;
+	unsigned int threads;
+	char name[16];
+	char pattern[16];
+} TASK;
+
 static char *cmd;
 static ADDR *list;
 static ADDR **sortedlist;
@@ -81,10 +288,26 @@ static THREAD *jobs;
 static THREAD **sortedjobs;
 static MAP *maps;
 static MAP **sortedmaps;
+static NODE *nodes;
+static NODE **sortednodes;
+static TASK *tasks;
+static TASK **sortedtasks;
+static int taskstotal;
+static HIST *hists;
+static EVENT *events;
+static char eventname[EVENTMAX][32];
+static int eventtotal;
+static char eventfail[128];
+static int eventthreads;
+static HEAP *heaps;
+static int histbits=3;
+static int histtotal;
+static int wallclock;
 static int tracetotal;
 static int addrtotal;
 static int maptotal;
 static int jobstotal;
+static int nodestotal;
 static int base;
 static int fpool;
 static int cpool;
@@ -92,12 +315,32 @@ static int fsize;
 static int csize;
 static int fmem;
 static int cmem;
+static int smem;
+static int shards;
 static int ssize;
 static int tmem;
 static int maxthreads;
+static int stacks;
+static int stackdepth;
+static int stackframes;
+static char clockname[16]="thread-cpu";
+static unsigned long long clockfreq=1000000000ULL;
+static unsigned long long overhead;
+static unsigned long long cachehits;
+static unsigned long long cachemisses;
+static unsigned long long recovered;
+static char clockfallback[16];
+static int clockthreads;
 static unsigned long long runtime;
 static unsigned long long cpuuse;
 static unsigned long long maxrss;
+static int pid;
+static int ppid;
+static int windows;
+static int windowfirst=-1;
+static int windowlast;
+static unsigned long long windowstart;
+static unsigned long long windowend;
 
 static int funcsort(const void *p1, const void *p2)
 {
@@ -165,6 +408,18 @@ static int jobssort(const void *p1, const void *p2)
 	return 0;
 }
 
+static int nodesort(const void *p1, const void *p2)
+{
+	const NODE **n1=(const NODE **)p1;
+	const NODE **n2=(const NODE **)p2;
+
+	if((*n1)->thread<(*n2)->thread)return -1;
+	if((*n1)->thread>(*n2)->thread)return 1;
+	if((*n1)->id<(*n2)->id)return -1;
+	if((*n1)->id>(*n2)->id)return 1;
+	return 0;
+}
+
 static int mapsort(const void *p1, const void *p2)
 {
 	const MAP **m1=(const MAP **)p1;
@@ -175,15 +430,260 @@ static int mapsort(const void *p1, const void *p2)
 	return 0;
 }
 
-static int readtrace(char *fn,int mode,char *pfx)
+static void funcinfo(unsigned long func,ADDR **funcdata,MAP **funcmap)
+{
+	int i=0;
+	int j=tracetotal;
+
+	while(i<j)
+	{
+		if(sorted[(i+j)>>1]->func<func)i=((i+j)>>1)+1;
+		else j=(i+j)>>1;
+	}
+	if(i<tracetotal&&sorted[i]->func==func)
+	{
+		*funcdata=sorted[i]->funcdata;
+		*funcmap=sorted[i]->funcmap;
+	}
+}
+
+static int newmap(unsigned long start,unsigned long end,char *file,char *pfx)
+{
+	char *ptr;
+	MAP *m;
+
+	for(m=maps;m;m=m->next)if(m->start==start&&m->end==end)return 0;
+
+	if(pfx)
+	{
+		if(!(m=malloc(sizeof(MAP)+strlen(file)+strlen(pfx)+2)))
+		{
+			perror("malloc");
+			return -1;
+		}
+	}
+	else if(!(m=malloc(sizeof(MAP)+strlen(file)+1)))
+	{
+		perror("malloc");
+		return -1;
+	}
+	m->start=start;
+	m->end=end;
+	if(pfx)
+	{
+		strcpy(m->file,pfx);
+		strcat(m->file,"/");
+		strcat(m->file,file);
+	}
+	else strcpy(m->file,file);
+	if((ptr=strrchr(m->file,'/')))m->brief=ptr+1;
+	else m->brief=m->file;
+	m->next=maps;
+	maps=m;
+	maptotal++;
+	return 0;
+}
+
+static long readbinary(FILE *fp,char *pfx)
+{
+	unsigned long long i;
+	long off=0;
+	struct stat st;
+	char *mem;
+	BINHDR *hdr;
+	BINCALLER *bc;
+	BINFUNC *bf;
+	BINMAP *bm;
+	TRACE *t;
+	THREAD *job;
+
+	if(fstat(fileno(fp),&st))
+	{
+		perror("fstat");
+		return -1;
+	}
+	if(st.st_size<sizeof(BINHDR))return 0;
+	if((mem=mmap(NULL,st.st_size,PROT_READ,MAP_PRIVATE,fileno(fp),0))==
+		MAP_FAILED)
+	{
+		perror("mmap");
+		return -1;
+	}
+	hdr=(BINHDR *)mem;
+	if(memcmp(hdr->magic,BINMAGIC,sizeof(BINMAGIC)))goto out;
+	off=-1;
+	if(hdr->version!=BINVERSION||hdr->size!=sizeof(BINHDR)||
+		hdr->callersize!=sizeof(BINCALLER)||
+		hdr->funcsize!=sizeof(BINFUNC)||
+		hdr->calleroff+hdr->callers*sizeof(BINCALLER)>hdr->funcoff||
+		hdr->funcoff+hdr->funcs*sizeof(BINFUNC)>hdr->mapoff||
+		hdr->mapoff>hdr->textoff||hdr->textoff>st.st_size)
+	{
+		fprintf(stderr,"unsupported binary instrumentation format\n");
+		goto out;
+	}
+
+	if(hdr->callers)
+	{
+		if(!(t=malloc(hdr->callers*sizeof(TRACE))))
+		{
+			perror("malloc");
+			goto out;
+		}
+		bc=(BINCALLER *)(mem+hdr->calleroff);
+		for(i=0;i<hdr->callers;i++,t++,bc++)
+		{
+			t->funcdata=NULL;
+			t->callerdata=NULL;
+			t->funcmap=NULL;
+			t->callermap=NULL;
+			t->func=bc->func;
+			t->caller=bc->caller;
+			t->calls=bc->calls;
+			t->nsecs=bc->nsecs;
+			t->calling=bc->calling;
+			t->unwind=bc->unwind;
+			t->overhead=bc->overhead;
+			t->incl=bc->incl;
+			t->incloverhead=bc->incloverhead;
+			t->incltrans=bc->incltrans;
+			t->wall=bc->wall;
+			t->offcpu=0;
+			t->next=data;
+			data=t;
+		}
+		tracetotal+=hdr->callers;
+	}
+
+	if(hdr->funcs)
+	{
+		if(!(job=malloc(hdr->funcs*sizeof(THREAD))))
+		{
+			perror("malloc");
+			goto out;
+		}
+		bf=(BINFUNC *)(mem+hdr->funcoff);
+		for(i=0;i<hdr->funcs;i++,job++,bf++)
+		{
+			job->funcdata=NULL;
+			job->funcmap=NULL;
+			job->func=bf->func;
+			job->calls=bf->calls;
+			job->nsecs=bf->nsecs;
+			job->funcs=bf->funcs;
+			job->unwind=bf->unwind;
+			job->depth=bf->depth;
+			job->overhead=bf->overhead;
+			job->next=jobs;
+			jobs=job;
+		}
+		jobstotal+=hdr->funcs;
+	}
+
+	for(i=0,bm=(BINMAP *)(mem+hdr->mapoff);i<hdr->maps;i++,
+		bm=(BINMAP *)((char *)bm+bm->size))
+	{
+		if((char *)bm+sizeof(BINMAP)>mem+hdr->textoff||
+			bm->size<sizeof(BINMAP)+bm->len+1||
+			(char *)bm+bm->size>mem+hdr->textoff)
+		{
+			fprintf(stderr,"corrupt binary map table\n");
+			goto out;
+		}
+		if(newmap(bm->start,bm->end,bm->file,pfx))goto out;
+	}
+
+	off=hdr->textoff;
+
+out:	munmap(mem,st.st_size);
+	return off;
+}
+
+static int mergewindows(void)
+{
+	int i;
+	int j;
+	TRACE *t;
+	TRACE **tl;
+	THREAD *job;
+	THREAD **jl;
+
+	if(tracetotal)
+	{
+		if(!(tl=malloc(tracetotal*sizeof(TRACE *))))
+		{
+			perror("malloc");
+			return -1;
+		}
+		for(i=0,t=data;i<tracetotal;i++,t=t->next)tl[i]=t;
+		qsort(tl,tracetotal,sizeof(TRACE *),funcsort);
+		for(i=1,j=0;i<tracetotal;i++)
+		{
+			if(tl[i]->func!=tl[j]->func||tl[i]->caller!=tl[j]->caller)
+			{
+				tl[++j]=tl[i];
+				continue;
+			}
+			tl[j]->calls+=tl[i]->calls;
+			tl[j]->nsecs+=tl[i]->nsecs;
+			tl[j]->calling+=tl[i]->calling;
+			tl[j]->unwind+=tl[i]->unwind;
+			tl[j]->overhead+=tl[i]->overhead;
+			tl[j]->incl+=tl[i]->incl;
+			tl[j]->incloverhead+=tl[i]->incloverhead;
+			tl[j]->incltrans+=tl[i]->incltrans;
+			tl[j]->wall+=tl[i]->wall;
+		}
+		for(tracetotal=j+1,data=NULL;j>=0;j--)
+		{
+			tl[j]->next=data;
+			data=tl[j];
+		}
+		free(tl);
+	}
+
+	if(jobstotal)
+	{
+		if(!(jl=malloc(jobstotal*sizeof(THREAD *))))
+		{
+			perror("malloc");
+			return -1;
+		}
+		for(i=0,job=jobs;i<jobstotal;i++,job=job->next)jl[i]=job;
+		qsort(jl,jobstotal,sizeof(THREAD *),jobssort);
+		for(i=1,j=0;i<jobstotal;i++)
+		{
+			if(jl[i]->func!=jl[j]->func)
+			{
+				jl[++j]=jl[i];
+				continue;
+			}
+			jl[j]->calls+=jl[i]->calls;
+			jl[j]->nsecs+=jl[i]->nsecs;
+			jl[j]->funcs+=jl[i]->funcs;
+			jl[j]->unwind+=jl[i]->unwind;
+			jl[j]->overhead+=jl[i]->overhead;
+			if(jl[i]->depth>jl[j]->depth)jl[j]->depth=jl[i]->depth;
+		}
+		for(jobstotal=j+1,jobs=NULL;j>=0;j--)
+		{
+			jl[j]->next=jobs;
+			jobs=jl[j];
+		}
+		free(jl);
+	}
+
+	return 0;
+}
+
+static int readfile(char *fn,char *pfx)
 {
 	int i;
 	int j;
-	int line;
 	int err=0;
-	int in[2];
-	int out[2];
+	long off;
 	unsigned long addr;
+	unsigned long long frames;
 	char *func;
 	char *caller;
 	char *calls;
@@ -192,17 +692,26 @@ static int readtrace(char *fn,int mode,char *pfx)
 	char *unwind;
 	char *funcs;
 	char *depth;
+	char *ovhd;
+	char *incl;
+	char *inclovhd;
+	char *incltrans;
+	char *wall;
+	char *thread;
+	char *id;
+	char *parent;
 	char *file;
 	char *ptr;
 	char *start;
 	char *end;
-	unsigned long *addrs;
 	TRACE *t;
-	ADDR *a;
 	THREAD *job;
-	MAP *m;
+	HIST *hg;
+	EVENT *ev;
+	HEAP *hp;
+	NODE *n;
+	TASK *task;
 	FILE *fp;
-	FILE *fp2;
 	char bfr[1024];
 
 	if(!(fp=fopen(fn,"re")))
@@ -210,6 +719,11 @@ static int readtrace(char *fn,int mode,char *pfx)
 		perror("fopen");
 		return -1;
 	}
+	if((off=readbinary(fp,pfx))<0||fseek(fp,off,SEEK_SET))
+	{
+		fclose(fp);
+		return -1;
+	}
 	while(fgets(bfr,sizeof(bfr),fp))
 	{
 		if(!strncmp(bfr,"TRACE: ",7))
@@ -219,7 +733,12 @@ static int readtrace(char *fn,int mode,char *pfx)
 			calls=strtok(NULL," ");
 			nsecs=strtok(NULL," ");
 			calling=strtok(NULL," ");
-			unwind=strtok(NULL,"\n");
+			unwind=strtok(NULL," \n");
+			ovhd=strtok(NULL," \n");
+			incl=strtok(NULL," ");
+			inclovhd=strtok(NULL," ");
+			incltrans=strtok(NULL," \n");
+			wall=strtok(NULL," \n");
 			if(!func||!caller||!calls||!nsecs||!calling||!unwind)
 				continue;
 			if(!(t=malloc(sizeof(TRACE))))
@@ -237,6 +756,21 @@ static int readtrace(char *fn,int mode,char *pfx)
 			t->nsecs=strtoll(nsecs,NULL,10);
 			t->calling=strtoll(calling,NULL,10);
 			t->unwind=strtoll(unwind,NULL,10);
+			t->overhead=ovhd?strtoull(ovhd,NULL,10):0;
+			if(incl&&inclovhd&&incltrans)
+			{
+				t->incl=strtoull(incl,NULL,10);
+				t->incloverhead=strtoull(inclovhd,NULL,10);
+				t->incltrans=strtoull(incltrans,NULL,10);
+			}
+			else
+			{
+				t->incl=0;
+				t->incloverhead=0;
+				t->incltrans=0;
+			}
+			t->wall=wall?strtoull(wall,NULL,10):0;
+			t->offcpu=0;
 			t->next=data;
 			data=t;
 			tracetotal++;
@@ -248,7 +782,8 @@ static int readtrace(char *fn,int mode,char *pfx)
 			nsecs=strtok(NULL," ");
 			funcs=strtok(NULL," ");
 			unwind=strtok(NULL," ");
-			depth=strtok(NULL,"\n");
+			depth=strtok(NULL," \n");
+			ovhd=strtok(NULL," \n");
 			if(!func||!calls||!nsecs||!funcs||!unwind||!depth)
 				continue;
 			if(!(job=malloc(sizeof(THREAD))))
@@ -264,53 +799,150 @@ static int readtrace(char *fn,int mode,char *pfx)
 			job->funcs=strtoll(funcs,NULL,10);
 			job->unwind=strtoll(unwind,NULL,10);
 			job->depth=strtoll(depth,NULL,10);
+			job->overhead=ovhd?strtoull(ovhd,NULL,10):0;
 			job->next=jobs;
 			jobs=job;
 			jobstotal++;
 		}
-		else if(!strncmp(bfr,"MAP: ",5))
+		else if(!strncmp(bfr,"CCT: ",5))
 		{
-			start=strtok(bfr+5," ");
-			end=strtok(NULL," ");
-			file=strtok(NULL,"\n");
-			if(!start||!end||!file)continue;
-			if(pfx)
+			thread=strtok(bfr+5," ");
+			id=strtok(NULL," ");
+			parent=strtok(NULL," ");
+			func=strtok(NULL," ");
+			strtok(NULL," ");
+			calls=strtok(NULL," ");
+			nsecs=strtok(NULL," ");
+			calling=strtok(NULL," ");
+			unwind=strtok(NULL," ");
+			ovhd=strtok(NULL," \n");
+			if(!thread||!id||!parent||!func||!calls||!nsecs||
+				!calling||!unwind||!ovhd)continue;
+			if(!(n=malloc(sizeof(NODE))))
+			{
+				perror("malloc");
+				return -1;
+			}
+			n->parent=NULL;
+			n->child=NULL;
+			n->sibling=NULL;
+			n->funcdata=NULL;
+			n->funcmap=NULL;
+			n->thread=atoi(thread);
+			n->id=atoi(id);
+			n->parentid=atoi(parent);
+			n->func=strtol(func,NULL,16);
+			n->calls=strtoll(calls,NULL,10);
+			n->nsecs=strtoll(nsecs,NULL,10);
+			n->calling=strtoll(calling,NULL,10);
+			n->unwind=strtoll(unwind,NULL,10);
+			n->overhead=strtoull(ovhd,NULL,10);
+			n->total=0;
+			n->next=nodes;
+			nodes=n;
+			nodestotal++;
+		}
+		else if(!strncmp(bfr,"HIST: ",6))
+		{
+			func=strtok(bfr+6," ");
+			ptr=strtok(NULL," ");
+			calls=strtok(NULL," \n");
+			if(!func||!ptr||!calls)continue;
+			addr=strtol(func,NULL,16);
+			if(!hists||hists->func!=addr)
 			{
-				if(!(m=malloc(sizeof(MAP)+strlen(file)+
-					strlen(pfx)+2)))
+				for(hg=hists;hg;hg=hg->next)
+					if(hg->func==addr)break;
+				if(!hg)
 				{
-					perror("malloc");
-					return -1;
+					if(!(hg=calloc(1,sizeof(HIST)+
+						((65-histbits)<<histbits)*
+						sizeof(unsigned long long))))
+					{
+						perror("calloc");
+						return -1;
+					}
+					hg->func=addr;
+					hg->next=hists;
+					hists=hg;
+					histtotal++;
 				}
 			}
-			else if(!(m=malloc(sizeof(MAP)+strlen(file)+1)))
+			else hg=hists;
+			if(!strcmp(ptr,"max"))hg->max=strtoull(calls,NULL,10);
+			else if((i=atoi(ptr))>=0&&i<((65-histbits)<<histbits))
+			{
+				hg->count[i]+=strtoull(calls,NULL,10);
+				hg->total+=strtoull(calls,NULL,10);
+			}
+		}
+		else if(!strncmp(bfr,"EVENT: ",7))
+		{
+			if(!(func=strtok(bfr+7," "))||!strtok(NULL," \n"))
+				continue;
+			if(!(ev=calloc(1,sizeof(EVENT))))
+			{
+				perror("calloc");
+				return -1;
+			}
+			ev->func=strtol(func,NULL,16);
+			for(i=0;i<EVENTMAX&&(ptr=strtok(NULL," \n"));i++)
+				ev->value[i]=strtoull(ptr,NULL,10);
+			ev->next=events;
+			events=ev;
+		}
+		else if(!strncmp(bfr,"ALLOC: ",7))
+		{
+			if(!(hp=malloc(sizeof(HEAP))))
 			{
 				perror("malloc");
 				return -1;
 			}
-			m->start=strtol(start,NULL,16);
-			m->end=strtol(end,NULL,16);
-			if(pfx)
+			if(sscanf(bfr+7,"%lx %*x %llu %llu %llu %llu",&hp->func,
+				&hp->allocs,&hp->frees,&hp->bytes,&hp->time)!=5)
 			{
-				strcpy(m->file,pfx);
-				strcat(m->file,"/");
-				strcat(m->file,file);
+				free(hp);
+				continue;
 			}
-			else strcpy(m->file,file);
-			if((ptr=strrchr(m->file,'/')))m->brief=ptr+1;
-			else m->brief=m->file;
-			m->next=maps;
-			maps=m;
-			maptotal++;
+			hp->next=heaps;
+			heaps=hp;
+		}
+		else if(!strncmp(bfr,"MAP: ",5))
+		{
+			start=strtok(bfr+5," ");
+			end=strtok(NULL," ");
+			file=strtok(NULL,"\n");
+			if(!start||!end||!file)continue;
+			if(newmap(strtol(start,NULL,16),strtol(end,NULL,16),
+				file,pfx))return -1;
 		}
 		else if(!strncmp(bfr,"INFO: ",6))
 		{
 			if(!strncmp(bfr+6,"runtime ",8))
-				runtime=strtoll(bfr+14,NULL,10);
+				runtime+=strtoll(bfr+14,NULL,10);
 			else if(!strncmp(bfr+6,"cpu-usage ",10))
-				cpuuse=strtoll(bfr+16,NULL,10);
+				cpuuse+=strtoll(bfr+16,NULL,10);
+			else if(!strncmp(bfr+6,"window ",7))
+			{
+				if(!(ptr=strtok(bfr+13," "))||
+					!(start=strtok(NULL," "))||
+					!(end=strtok(NULL," \n")))continue;
+				i=atoi(ptr);
+				if(!windows++||i<windowfirst)
+				{
+					windowfirst=i;
+					windowstart=strtoull(start,NULL,10);
+				}
+				if(windows==1||i>windowlast)
+				{
+					windowlast=i;
+					windowend=strtoull(end,NULL,10);
+				}
+			}
 			else if(!strncmp(bfr+6,"maxrss ",7))
 				maxrss=strtoll(bfr+13,NULL,10);
+			else if(!strncmp(bfr+6,"pid ",4))pid=atoi(bfr+10);
+			else if(!strncmp(bfr+6,"ppid ",5))ppid=atoi(bfr+11);
 			else if(!strncmp(bfr+6,"f-pool-use ",11))
 				fpool=atoi(bfr+17);
 			else if(!strncmp(bfr+6,"f-pool-size ",12))
@@ -323,24 +955,76 @@ static int readtrace(char *fn,int mode,char *pfx)
 				csize=atoi(bfr+18);
 			else if(!strncmp(bfr+6,"c-pool-mem ",11))
 				cmem=atoi(bfr+17);
+			else if(!strncmp(bfr+6,"shards ",7))
+				shards=atoi(bfr+13);
+			else if(!strncmp(bfr+6,"s-pool-mem ",11))
+				smem=atoi(bfr+17);
 			else if(!strncmp(bfr+6,"stack-size ",11))
 				ssize=atoi(bfr+17);
 			else if(!strncmp(bfr+6,"thread-mem ",11))
 				tmem=atoi(bfr+17);
 			else if(!strncmp(bfr+6,"max-threads ",12))
 				maxthreads=atoi(bfr+18);
-		}
-		else if(!strncmp(bfr,"CMD: ",5))
-		{
-			if(pfx)
+			else if(!strncmp(bfr+6,"clock ",6))
 			{
-				if((ptr=strtok(bfr+5," \n")))
+				if(!(ptr=strtok(bfr+12," "))||
+					!(start=strtok(NULL,"\n")))continue;
+				strncpy(clockname,ptr,sizeof(clockname)-1);
+				if(!(clockfreq=strtoull(start,NULL,10)))
 				{
-					if(!(cmd=malloc(strlen(pfx)+strlen(ptr)
-						+2)))
-					{
-						perror("malloc");
-						return -1;
+					fprintf(stderr,"invalid clock frequency\n");
+					return -1;
+				}
+			}
+			else if(!strncmp(bfr+6,"cache-hits ",11))
+				cachehits=strtoull(bfr+17,NULL,10);
+			else if(!strncmp(bfr+6,"cache-misses ",13))
+				cachemisses=strtoull(bfr+19,NULL,10);
+			else if(!strncmp(bfr+6,"recovered ",10))
+				recovered+=strtoull(bfr+16,NULL,10);
+			else if(!strncmp(bfr+6,"hist-bits ",10))
+			{
+				if((histbits=atoi(bfr+16))<1||histbits>8)
+					histbits=3;
+			}
+			else if(!strncmp(bfr+6,"wallclock ",10))
+				wallclock=atoi(bfr+16);
+			else if(!strncmp(bfr+6,"overhead ",9))
+				overhead=strtoull(bfr+15,NULL,10);
+			else if(!strncmp(bfr+6,"clock-fallback ",15))
+			{
+				if(!(ptr=strtok(bfr+21," \n")))continue;
+				strncpy(clockfallback,ptr,sizeof(clockfallback)-1);
+			}
+			else if(!strncmp(bfr+6,"clock-fallback-threads ",23))
+				clockthreads=atoi(bfr+29);
+			else if(!strncmp(bfr+6,"events ",7))
+			{
+				for(eventtotal=0,ptr=strtok(bfr+13,",\n");
+					ptr&&eventtotal<EVENTMAX;
+					ptr=strtok(NULL,",\n"))
+					strncpy(eventname[eventtotal++],ptr,
+						sizeof(eventname[0])-1);
+			}
+			else if(!strncmp(bfr+6,"events-unavailable ",19))
+			{
+				if(!(ptr=strtok(bfr+25,"\n")))continue;
+				strncpy(eventfail,ptr,sizeof(eventfail)-1);
+			}
+			else if(!strncmp(bfr+6,"events-fallback-threads ",24))
+				eventthreads=atoi(bfr+30);
+		}
+		else if(!strncmp(bfr,"CMD: ",5))
+		{
+			if(pfx)
+			{
+				if((ptr=strtok(bfr+5," \n")))
+				{
+					if(!(cmd=malloc(strlen(pfx)+strlen(ptr)
+						+2)))
+					{
+						perror("malloc");
+						return -1;
 					}
 					strcpy(cmd,pfx);
 					strcat(cmd,"/");
@@ -353,6 +1037,73 @@ static int readtrace(char *fn,int mode,char *pfx)
 				return -1;
 			}
 		}
+		else if(!strncmp(bfr,"STACK: ",7))
+		{
+			if(!strtok(bfr+7," ")||!(depth=strtok(NULL," "))||
+				!(ptr=strtok(NULL," \n")))continue;
+			stacks++;
+			if(atoi(depth)>stackdepth)stackdepth=atoi(depth);
+			if(atoi(ptr)>stackframes)stackframes=atoi(ptr);
+		}
+		else if(!strncmp(bfr,"TASK: ",6))
+		{
+			if(!(task=malloc(sizeof(TASK))))
+			{
+				perror("malloc");
+				return -1;
+			}
+			if(sscanf(bfr+6,"%d %d %llu %llu %llu %llu %llu %llu %llu "
+				"%n",&task->id,&task->tid,&task->calls,
+				&task->funcs,&task->nsecs,&task->overhead,
+				&task->unwind,&task->depth,&task->lifetime,&i)<9)
+			{
+				free(task);
+				continue;
+			}
+			if((ptr=strchr(bfr+6+i,'\n')))*ptr=0;
+			snprintf(task->name,sizeof(task->name),"%s",bfr+6+i);
+			for(i=0,j=0;task->name[i];i++)
+			{
+				if(task->name[i]<'0'||task->name[i]>'9')
+					task->pattern[j++]=task->name[i];
+				else if(!j||task->pattern[j-1]!='*')
+					task->pattern[j++]='*';
+			}
+			task->pattern[j]=0;
+			task->maxtime=0;
+			task->threads=1;
+			task->next=tasks;
+			tasks=task;
+			taskstotal++;
+		}
+		else if(!strncmp(bfr,"TASKS: ",7))
+		{
+			if(!(task=malloc(sizeof(TASK))))
+			{
+				perror("malloc");
+				return -1;
+			}
+			if(sscanf(bfr+7,"%u %llu %llu %llu %llu %llu %llu %llu "
+				"%llu %llu %15s",&task->threads,&task->calls,
+				&task->funcs,&task->nsecs,&task->overhead,
+				&task->unwind,&task->depth,&frames,
+				&task->maxtime,&task->lifetime,task->pattern)<11||
+				!task->threads)
+			{
+				free(task);
+				continue;
+			}
+			stacks+=task->threads;
+			if(task->depth>(unsigned int)stackdepth)
+				stackdepth=task->depth;
+			if(frames>(unsigned int)stackframes)stackframes=frames;
+			task->id=0;
+			task->tid=0;
+			strcpy(task->name,task->pattern);
+			task->next=tasks;
+			tasks=task;
+			taskstotal++;
+		}
 		else if(!strncmp(bfr,"ERROR: ",7))
 		{
 			printf("%s",bfr);
@@ -362,12 +1113,33 @@ static int readtrace(char *fn,int mode,char *pfx)
 	fclose(fp);
 
 	if(err)return -1;
+	return 0;
+}
 
-	if(!tracetotal)
-	{
-		fprintf(stderr,"incomplete input\n");
-		return -1;
-	}
+static int resolve(int mode)
+{
+	int i;
+	int j;
+	int line;
+	int in[2];
+	int out[2];
+	unsigned long addr;
+	char *func;
+	char *file;
+	char *ptr;
+	unsigned long *addrs;
+	TRACE *t;
+	ADDR *a;
+	THREAD *job;
+	MAP *m;
+	HIST *hg;
+	NODE *n;
+	NODE k;
+	NODE *key=&k;
+	NODE **pn;
+	FILE *fp;
+	FILE *fp2;
+	char bfr[1024];
 
 	if(!(sortedmaps=malloc(maptotal*sizeof(MAP *))))
 	{
@@ -660,6 +1432,40 @@ static int readtrace(char *fn,int mode,char *pfx)
 
 	qsort(sortedcaller,tracetotal,sizeof(TRACE *),calleridsort);
 
+	if(nodestotal)
+	{
+		if(!(sortednodes=malloc(nodestotal*sizeof(NODE *))))
+		{
+			perror("malloc");
+			return -1;
+		}
+
+		for(i=0,n=nodes;i<nodestotal;i++,n=n->next)sortednodes[i]=n;
+
+		qsort(sortednodes,nodestotal,sizeof(NODE *),nodesort);
+
+		for(i=nodestotal-1;i>=0;i--)
+		{
+			n=sortednodes[i];
+			if(n->parentid)
+			{
+				key->thread=n->thread;
+				key->id=n->parentid;
+				if((pn=bsearch(&key,sortednodes,nodestotal,
+					sizeof(NODE *),nodesort)))
+				{
+					n->parent=*pn;
+					n->sibling=(*pn)->child;
+					(*pn)->child=n;
+				}
+			}
+			funcinfo(n->func,&n->funcdata,&n->funcmap);
+		}
+	}
+
+	for(hg=hists;hg;hg=hg->next)
+		funcinfo(hg->func,&hg->funcdata,&hg->funcmap);
+
 	for(i=1,j=tracetotal;j;j>>=1,i<<=1);
 	if(!(tracetotal&~(i>>1)))i>>=1;
 	base=i>>1;
@@ -667,6 +1473,50 @@ static int readtrace(char *fn,int mode,char *pfx)
 	return 0;
 }
 
+static int readtrace(char *fn,int mode,char *pfx,int first,int last)
+{
+	int i;
+	TASK *task;
+	char bfr[1024];
+
+	if(first<0)
+	{
+		if(readfile(fn,pfx))return -1;
+	}
+	else for(i=first;i<=last;i++)
+	{
+		snprintf(bfr,sizeof(bfr),"%s.%d",fn,i);
+		if(readfile(bfr,pfx))return -1;
+	}
+
+	if(first>=0&&first!=last&&mergewindows())return -1;
+
+	if(!tracetotal)
+	{
+		if(first<0)fprintf(stderr,"incomplete input\n");
+		else fprintf(stderr,"no calls recorded in selected window(s)\n");
+		return -1;
+	}
+
+	if(!(sortedtasks=malloc((taskstotal+1)*sizeof(TASK *))))
+	{
+		perror("malloc");
+		return -1;
+	}
+
+	for(i=0,task=tasks;i<taskstotal;i++,task=task->next)
+		sortedtasks[i]=task;
+
+	return resolve(mode);
+}
+
+static unsigned long long ticks2ns(unsigned long long ticks)
+{
+	if(clockfreq==1000000000ULL)return ticks;
+	return (ticks/clockfreq)*1000000000ULL+
+		(ticks%clockfreq)*1000000000ULL/clockfreq;
+}
+
 static int adjust(int adjust)
 {
 	int i;
@@ -674,15 +1524,46 @@ static int adjust(int adjust)
 
 	for(i=0;i<tracetotal;i++)
 	{
+		if(sorted[i]->overhead>sorted[i]->nsecs)sorted[i]->nsecs=0;
+		else sorted[i]->nsecs-=sorted[i]->overhead;
+		sorted[i]->nsecs=ticks2ns(sorted[i]->nsecs);
+
 		adj=adjust;
 		adj*=sorted[i]->calls+sorted[i]->calling-sorted[i]->unwind;
 
 		if(adj>sorted[i]->nsecs)sorted[i]->nsecs=0;
 		else sorted[i]->nsecs-=adj;
+
+		if(sorted[i]->incloverhead>sorted[i]->incl)sorted[i]->incl=0;
+		else sorted[i]->incl-=sorted[i]->incloverhead;
+		sorted[i]->incl=ticks2ns(sorted[i]->incl);
+
+		adj=adjust;
+		adj*=sorted[i]->incltrans;
+
+		if(adj>sorted[i]->incl)sorted[i]->incl=0;
+		else sorted[i]->incl-=adj;
+
+		if(!wallclock)continue;
+
+		adj=adjust;
+		adj*=sorted[i]->calls+sorted[i]->calling-sorted[i]->unwind;
+		adj+=ticks2ns(sorted[i]->overhead);
+
+		if(adj>sorted[i]->wall)sorted[i]->wall=0;
+		else sorted[i]->wall-=adj;
+
+		if(sorted[i]->wall>sorted[i]->nsecs)
+			sorted[i]->offcpu=sorted[i]->wall-sorted[i]->nsecs;
 	}
 
 	for(i=0;i<jobstotal;i++)
 	{
+		if(sortedjobs[i]->overhead>sortedjobs[i]->nsecs)
+			sortedjobs[i]->nsecs=0;
+		else sortedjobs[i]->nsecs-=sortedjobs[i]->overhead;
+		sortedjobs[i]->nsecs=ticks2ns(sortedjobs[i]->nsecs);
+
 		adj=adjust;
 		adj*=(sortedjobs[i]->funcs<<1)-sortedjobs[i]->calls-
 			sortedjobs[i]->unwind;
@@ -690,7 +1571,47 @@ static int adjust(int adjust)
 		if(adj>sortedjobs[i]->nsecs)sortedjobs[i]->nsecs=0;
 		else sortedjobs[i]->nsecs-=adj;
 
-		sortedjobs[i]->avg=sortedjobs[i]->nsecs/sortedjobs[i]->calls;
+		sortedjobs[i]->avg=sortedjobs[i]->calls?
+			sortedjobs[i]->nsecs/sortedjobs[i]->calls:0;
+	}
+
+	for(i=0;i<taskstotal;i++)
+	{
+		if(sortedtasks[i]->overhead>sortedtasks[i]->nsecs)
+			sortedtasks[i]->nsecs=0;
+		else sortedtasks[i]->nsecs-=sortedtasks[i]->overhead;
+		sortedtasks[i]->nsecs=ticks2ns(sortedtasks[i]->nsecs);
+
+		adj=adjust;
+		adj*=(sortedtasks[i]->funcs<<1)-sortedtasks[i]->calls-
+			sortedtasks[i]->unwind;
+
+		if(adj>sortedtasks[i]->nsecs)sortedtasks[i]->nsecs=0;
+		else sortedtasks[i]->nsecs-=adj;
+
+		if(sortedtasks[i]->threads==1)
+			sortedtasks[i]->maxtime=sortedtasks[i]->nsecs;
+		else sortedtasks[i]->maxtime=
+			ticks2ns(sortedtasks[i]->maxtime);
+	}
+
+	for(i=nodestotal-1;i>=0;i--)
+	{
+		if(sortednodes[i]->overhead>sortednodes[i]->nsecs)
+			sortednodes[i]->nsecs=0;
+		else sortednodes[i]->nsecs-=sortednodes[i]->overhead;
+		sortednodes[i]->nsecs=ticks2ns(sortednodes[i]->nsecs);
+
+		adj=adjust;
+		adj*=sortednodes[i]->calls+sortednodes[i]->calling-
+			sortednodes[i]->unwind;
+
+		if(adj>sortednodes[i]->nsecs)sortednodes[i]->nsecs=0;
+		else sortednodes[i]->nsecs-=adj;
+
+		sortednodes[i]->total+=sortednodes[i]->nsecs;
+		if(sortednodes[i]->parent)
+			sortednodes[i]->parent->total+=sortednodes[i]->total;
 	}
 
 	return 0;
@@ -732,6 +1653,66 @@ static int avgcpusort(const void *p1, const void *p2)
 	return 0;
 }
 
+static int inclsort(const void *p1, const void *p2)
+{
+	const FUNC *f1=p1;
+	const FUNC *f2=p2;
+
+	if(f1->incl<f2->incl)return 1;
+	if(f1->incl>f2->incl)return -1;
+	if(f1->func<f2->func)return -1;
+	if(f1->func>f2->func)return 1;
+	return 0;
+}
+
+static int avginclsort(const void *p1, const void *p2)
+{
+	const FUNC *f1=p1;
+	const FUNC *f2=p2;
+
+	if(f1->avgincl<f2->avgincl)return 1;
+	if(f1->avgincl>f2->avgincl)return -1;
+	if(f1->func<f2->func)return -1;
+	if(f1->func>f2->func)return 1;
+	return 0;
+}
+
+static int offcpusort(const void *p1, const void *p2)
+{
+	const FUNC *f1=p1;
+	const FUNC *f2=p2;
+
+	if(f1->offcpu<f2->offcpu)return 1;
+	if(f1->offcpu>f2->offcpu)return -1;
+	if(f1->func<f2->func)return -1;
+	if(f1->func>f2->func)return 1;
+	return 0;
+}
+
+static int avgoffsort(const void *p1, const void *p2)
+{
+	const FUNC *f1=p1;
+	const FUNC *f2=p2;
+
+	if(f1->avgoff<f2->avgoff)return 1;
+	if(f1->avgoff>f2->avgoff)return -1;
+	if(f1->func<f2->func)return -1;
+	if(f1->func>f2->func)return 1;
+	return 0;
+}
+
+static int unwindsort(const void *p1, const void *p2)
+{
+	const FUNC *f1=p1;
+	const FUNC *f2=p2;
+
+	if(f1->unwind<f2->unwind)return 1;
+	if(f1->unwind>f2->unwind)return -1;
+	if(f1->func<f2->func)return -1;
+	if(f1->func>f2->func)return 1;
+	return 0;
+}
+
 static int tops(int mode,int brief)
 {
 	int i;
@@ -739,6 +1720,13 @@ static int tops(int mode,int brief)
 	int total;
 	FUNC *list;
 
+	if((mode==6||mode==7)&&!wallclock)
+	{
+		fprintf(stderr,"no wall clock time recorded, set "
+			"PROFILE_WALLCLOCK when profiling\n");
+		return -1;
+	}
+
 	if(!(list=malloc(tracetotal*sizeof(FUNC))))
 	{
 		perror("malloc");
@@ -751,6 +1739,10 @@ static int tops(int mode,int brief)
 		{
 			list[total-1].calls+=sorted[i]->calls;
 			list[total-1].nsecs+=sorted[i]->nsecs;
+			list[total-1].incl+=sorted[i]->incl;
+			list[total-1].wall+=sorted[i]->wall;
+			list[total-1].offcpu+=sorted[i]->offcpu;
+			list[total-1].unwind+=sorted[i]->unwind;
 			continue;
 		}
 		list[total].func=sorted[i]->func;
@@ -758,10 +1750,25 @@ static int tops(int mode,int brief)
 		list[total].funcmap=sorted[i]->funcmap;
 		list[total].calls=sorted[i]->calls;
 		list[total].nsecs=sorted[i]->nsecs;
-		list[total].avg=list[total].nsecs/list[total].calls;
+		list[total].incl=sorted[i]->incl;
+		list[total].wall=sorted[i]->wall;
+		list[total].offcpu=sorted[i]->offcpu;
+		list[total].unwind=sorted[i]->unwind;
 		total++;
 	}
 
+	for(i=0;i<total;i++)
+	{
+		if(!list[i].calls)
+		{
+			list[i].avg=list[i].avgincl=list[i].avgoff=0;
+			continue;
+		}
+		list[i].avg=list[i].nsecs/list[i].calls;
+		list[i].avgincl=list[i].incl/list[i].calls;
+		list[i].avgoff=list[i].offcpu/list[i].calls;
+	}
+
 	switch(mode)
 	{
 	case 0:	printf("\nFunctions sorted by amount of calls:\n\n");
@@ -780,12 +1787,53 @@ static int tops(int mode,int brief)
 	case 3: printf("\nFunctions sorted by average CPU usage:\n\n");
 		qsort(list,total,sizeof(FUNC),avgcpusort);
 		break;
+
+	case 4: printf("\nFunctions sorted by inclusive CPU usage:\n\n");
+		qsort(list,total,sizeof(FUNC),inclsort);
+		break;
+
+	case 5: printf("\nFunctions sorted by average inclusive CPU usage:\n\n");
+		qsort(list,total,sizeof(FUNC),avginclsort);
+		break;
+
+	case 6: printf("\nFunctions sorted by off-CPU time:\n\n");
+		qsort(list,total,sizeof(FUNC),offcpusort);
+		break;
+
+	case 7: printf("\nFunctions sorted by average off-CPU time:\n\n");
+		qsort(list,total,sizeof(FUNC),avgoffsort);
+		break;
+
+	case 8: printf("\nFunctions sorted by forced unwinds (calls without"
+			" return):\n\n");
+		qsort(list,total,sizeof(FUNC),unwindsort);
+		while(total&&!list[total-1].unwind)total--;
+		break;
 	}
 
-	printf("Function                                               "
-		"Calls        CPU Usage\n");
-	printf("======================================================="
-		"=========================\n");
+	if(mode==8)
+	{
+		printf("Function                                               "
+			"Calls          Unwinds        CPU Usage\n");
+		printf("======================================================="
+			"==========================================\n");
+	}
+	else if(mode>=6)
+	{
+		printf("Function                                               "
+			"Calls        CPU Usage        Wall Time"
+			"          Off-CPU\n");
+		printf("======================================================="
+			"=========================================="
+			"=================\n");
+	}
+	else
+	{
+		printf("Function                                               "
+			"Calls        CPU Usage        Inclusive\n");
+		printf("======================================================="
+			"==========================================\n");
+	}
 	for(i=0;i<total;i++)
 	{
 		if(list[i].funcdata)
@@ -808,61 +1856,503 @@ static int tops(int mode,int brief)
 		while(l<43)l+=printf("          ");
 		while(l<53)l+=printf(" ");
 
-		if(mode<2)printf(" %7llu %7llu.%09llu\n",list[i].calls,
-			list[i].nsecs/1000000000,list[i].nsecs%1000000000);
-		else printf(" %7llu %7llu.%09llu\n",list[i].calls,
-			list[i].avg/1000000000,list[i].avg%1000000000);
+		if(mode==8)printf(" %7llu %16llu %7llu.%09llu\n",
+			list[i].calls,list[i].unwind,list[i].nsecs/1000000000,
+			list[i].nsecs%1000000000);
+		else if(mode==6)printf(" %7llu %7llu.%09llu %7llu.%09llu "
+			"%7llu.%09llu\n",list[i].calls,
+			list[i].nsecs/1000000000,list[i].nsecs%1000000000,
+			list[i].wall/1000000000,list[i].wall%1000000000,
+			list[i].offcpu/1000000000,list[i].offcpu%1000000000);
+		else if(mode==7)printf(" %7llu %7llu.%09llu %7llu.%09llu "
+			"%7llu.%09llu\n",list[i].calls,
+			list[i].avg/1000000000,list[i].avg%1000000000,
+			list[i].calls?list[i].wall/list[i].calls/1000000000:0,
+			list[i].calls?list[i].wall/list[i].calls%1000000000:0,
+			list[i].avgoff/1000000000,list[i].avgoff%1000000000);
+		else if(mode<2||mode==4)printf(" %7llu %7llu.%09llu "
+			"%7llu.%09llu\n",list[i].calls,
+			list[i].nsecs/1000000000,list[i].nsecs%1000000000,
+			list[i].incl/1000000000,list[i].incl%1000000000);
+		else printf(" %7llu %7llu.%09llu %7llu.%09llu\n",
+			list[i].calls,list[i].avg/1000000000,
+			list[i].avg%1000000000,list[i].avgincl/1000000000,
+			list[i].avgincl%1000000000);
 	}
 
 	free(list);
 	return 0;
 }
 
-static int jobcallsort(const void *p1, const void *p2)
-{
-	const THREAD **j1=(const THREAD **)p1;
-	const THREAD **j2=(const THREAD **)p2;
-
-	if((*j1)->calls<(*j2)->calls)return 1;
-	if((*j1)->calls>(*j2)->calls)return -1;
-	if((*j1)->func<(*j2)->func)return -1;
-	if((*j1)->func>(*j2)->func)return 1;
-	return 0;
-}
-
-static int jobcpusort(const void *p1, const void *p2)
+static int funcaddrsort(const void *p1, const void *p2)
 {
-	const THREAD **j1=(const THREAD **)p1;
-	const THREAD **j2=(const THREAD **)p2;
+	const FUNC *f1=p1;
+	const FUNC *f2=p2;
 
-	if((*j1)->nsecs<(*j2)->nsecs)return 1;
-	if((*j1)->nsecs>(*j2)->nsecs)return -1;
-	if((*j1)->func<(*j2)->func)return -1;
-	if((*j1)->func>(*j2)->func)return 1;
+	if(f1->func<f2->func)return -1;
+	if(f1->func>f2->func)return 1;
 	return 0;
 }
 
-static int jobavgcpusort(const void *p1, const void *p2)
+static int keysort(const void *p1, const void *p2)
 {
-	const THREAD **j1=(const THREAD **)p1;
-	const THREAD **j2=(const THREAD **)p2;
+	const FUNC *f1=p1;
+	const FUNC *f2=p2;
 
-	if((*j1)->avg<(*j2)->avg)return 1;
-	if((*j1)->avg>(*j2)->avg)return -1;
-	if((*j1)->func<(*j2)->func)return -1;
-	if((*j1)->func>(*j2)->func)return 1;
+	if(f1->key<f2->key)return 1;
+	if(f1->key>f2->key)return -1;
+	if(f1->func<f2->func)return -1;
+	if(f1->func>f2->func)return 1;
 	return 0;
 }
 
-static int jobsproc(int mode,int brief)
+static int eventsproc(char *name,int avg,int brief)
 {
 	int i;
+	int j;
+	int k;
 	int l;
+	int total;
+	int cycles=-1;
+	int instructions=-1;
+	double v;
+	EVENT *ev;
+	FUNC *f;
+	FUNC *list;
+	FUNC key;
 
-	switch(mode)
+	if(!eventtotal)
 	{
-	case 0:	printf("\nThreads sorted by amount of calls:\n\n");
-		qsort(sortedjobs,jobstotal,sizeof(THREAD *),jobcallsort);
+		if(*eventfail)fprintf(stderr,"events %s were unavailable when "
+			"profiling\n",eventfail);
+		else fprintf(stderr,"no events recorded, set PROFILE_EVENTS "
+			"when profiling\n");
+		return -1;
+	}
+
+	for(i=0;i<eventtotal;i++)
+	{
+		if(!strcmp(eventname[i],"cycles"))cycles=i;
+		else if(!strcmp(eventname[i],"instructions"))instructions=i;
+	}
+
+	if(!strcmp(name,"ipc"))
+	{
+		if(cycles==-1||instructions==-1)
+		{
+			fprintf(stderr,"ipc requires the cycles and instructions "
+				"events\n");
+			return -1;
+		}
+		k=-1;
+	}
+	else
+	{
+		for(k=0;k<eventtotal;k++)if(!strcmp(eventname[k],name))break;
+		if(k==eventtotal)
+		{
+			fprintf(stderr,"event %s not recorded\n",name);
+			return -1;
+		}
+	}
+
+	if(!(list=calloc(tracetotal,sizeof(FUNC))))
+	{
+		perror("calloc");
+		return -1;
+	}
+
+	for(i=0,total=0;i<tracetotal;i++)
+	{
+		if(i&&sorted[i-1]->func==sorted[i]->func)
+		{
+			list[total-1].calls+=sorted[i]->calls;
+			list[total-1].nsecs+=sorted[i]->nsecs;
+			continue;
+		}
+		list[total].func=sorted[i]->func;
+		list[total].funcdata=sorted[i]->funcdata;
+		list[total].funcmap=sorted[i]->funcmap;
+		list[total].calls=sorted[i]->calls;
+		list[total].nsecs=sorted[i]->nsecs;
+		total++;
+	}
+
+	qsort(list,total,sizeof(FUNC),funcaddrsort);
+	for(ev=events;ev;ev=ev->next)
+	{
+		key.func=ev->func;
+		if(!(f=bsearch(&key,list,total,sizeof(FUNC),funcaddrsort)))
+			continue;
+		for(i=0;i<eventtotal;i++)f->events[i]+=ev->value[i];
+	}
+
+	for(i=0,j=0;i<total;i++)
+	{
+		if(k==-1)
+		{
+			if(!list[i].events[cycles])continue;
+			list[i].key=-(double)list[i].events[instructions]/
+				list[i].events[cycles];
+		}
+		else
+		{
+			if(!list[i].events[k])continue;
+			list[i].key=list[i].events[k];
+			if(avg)list[i].key/=list[i].calls?list[i].calls:1;
+		}
+		list[j++]=list[i];
+	}
+	total=j;
+
+	qsort(list,total,sizeof(FUNC),keysort);
+
+	if(k==-1)printf("\nFunctions sorted by instructions per cycle (lowest"
+		" first):\n\n");
+	else if(avg)printf("\nFunctions sorted by average %s per call:\n\n",
+		name);
+	else printf("\nFunctions sorted by %s:\n\n",name);
+
+	l=printf("Function                                               "
+		"Calls        CPU Usage");
+	for(i=0;i<eventtotal;i++)l+=printf(" %16.16s",eventname[i]);
+	if(cycles!=-1&&instructions!=-1)l+=printf("    IPC");
+	printf("\n");
+	while(l--)printf("=");
+	printf("\n");
+
+	for(i=0;i<total;i++)
+	{
+		if(list[i].funcdata)
+		{
+			if(!list[i].funcdata->line)l=printf("%s (%s) ",
+				list[i].funcdata->func,
+				list[i].funcdata->file);
+			else l=printf("%s (%s:%d) ",list[i].funcdata->func,
+				list[i].funcdata->file,
+				list[i].funcdata->line);
+		}
+		else if(list[i].funcmap)
+		{
+			l=printf("%s+%p ",brief?list[i].funcmap->brief:
+				list[i].funcmap->file,(void *)(list[i].func-
+				list[i].funcmap->start));
+		}
+		else l=printf("%p ",(void *)list[i].func);
+
+		while(l<43)l+=printf("          ");
+		while(l<53)l+=printf(" ");
+
+		printf(" %7llu %7llu.%09llu",list[i].calls,
+			list[i].nsecs/1000000000,list[i].nsecs%1000000000);
+		for(j=0;j<eventtotal;j++)
+		{
+			if(!avg)printf(" %16llu",list[i].events[j]);
+			else
+			{
+				v=list[i].events[j];
+				if(list[i].calls)v/=list[i].calls;
+				printf(" %16.2f",v);
+			}
+		}
+		if(cycles!=-1&&instructions!=-1)
+		{
+			if(list[i].events[cycles])printf(" %6.2f",
+				(double)list[i].events[instructions]/
+				list[i].events[cycles]);
+			else printf("      -");
+		}
+		printf("\n");
+	}
+
+	free(list);
+	return 0;
+}
+
+static int heapsort(const void *p1, const void *p2)
+{
+	const FUNC *f1=p1;
+	const FUNC *f2=p2;
+
+	if(f1->bytes<f2->bytes)return 1;
+	if(f1->bytes>f2->bytes)return -1;
+	if(f1->func<f2->func)return -1;
+	if(f1->func>f2->func)return 1;
+	return 0;
+}
+
+static int heapcountsort(const void *p1, const void *p2)
+{
+	const FUNC *f1=p1;
+	const FUNC *f2=p2;
+
+	if(f1->allocs<f2->allocs)return 1;
+	if(f1->allocs>f2->allocs)return -1;
+	if(f1->func<f2->func)return -1;
+	if(f1->func>f2->func)return 1;
+	return 0;
+}
+
+static int heapproc(int mode,int brief)
+{
+	int i;
+	int j;
+	int l;
+	int total;
+	unsigned long long ns;
+	HEAP *hp;
+	FUNC *f;
+	FUNC *list;
+	FUNC key;
+
+	if(!heaps)
+	{
+		fprintf(stderr,"no allocations recorded, define PROFILE_ALLOC "
+			"before including profiler.h\n");
+		return -1;
+	}
+
+	if(!(list=calloc(tracetotal,sizeof(FUNC))))
+	{
+		perror("calloc");
+		return -1;
+	}
+
+	for(i=0,total=0;i<tracetotal;i++)
+	{
+		if(i&&sorted[i-1]->func==sorted[i]->func)
+		{
+			list[total-1].calls+=sorted[i]->calls;
+			continue;
+		}
+		list[total].func=sorted[i]->func;
+		list[total].funcdata=sorted[i]->funcdata;
+		list[total].funcmap=sorted[i]->funcmap;
+		list[total].calls=sorted[i]->calls;
+		total++;
+	}
+
+	qsort(list,total,sizeof(FUNC),funcaddrsort);
+	for(hp=heaps;hp;hp=hp->next)
+	{
+		key.func=hp->func;
+		if(!(f=bsearch(&key,list,total,sizeof(FUNC),funcaddrsort)))
+			continue;
+		f->allocs+=hp->allocs;
+		f->frees+=hp->frees;
+		f->bytes+=hp->bytes;
+		f->atime+=hp->time;
+	}
+
+	for(i=0,j=0;i<total;i++)if(list[i].allocs||list[i].frees)
+		list[j++]=list[i];
+	total=j;
+
+	if(!mode)
+	{
+		printf("\nFunctions sorted by allocated bytes:\n\n");
+		qsort(list,total,sizeof(FUNC),heapsort);
+	}
+	else
+	{
+		printf("\nFunctions sorted by amount of allocations:\n\n");
+		qsort(list,total,sizeof(FUNC),heapcountsort);
+	}
+
+	printf("Function                                               "
+		"Calls      Allocations            Frees            Bytes"
+		"   Allocator Time\n");
+	printf("======================================================="
+		"=============================================="
+		"=========================\n");
+	for(i=0;i<total;i++)
+	{
+		if(list[i].funcdata)
+		{
+			if(!list[i].funcdata->line)l=printf("%s (%s) ",
+				list[i].funcdata->func,
+				list[i].funcdata->file);
+			else l=printf("%s (%s:%d) ",list[i].funcdata->func,
+				list[i].funcdata->file,
+				list[i].funcdata->line);
+		}
+		else if(list[i].funcmap)
+		{
+			l=printf("%s+%p ",brief?list[i].funcmap->brief:
+				list[i].funcmap->file,(void *)(list[i].func-
+				list[i].funcmap->start));
+		}
+		else l=printf("%p ",(void *)list[i].func);
+
+		while(l<43)l+=printf("          ");
+		while(l<53)l+=printf(" ");
+
+		ns=ticks2ns(list[i].atime);
+		printf(" %7llu %16llu %16llu %16llu %7llu.%09llu\n",
+			list[i].calls,list[i].allocs,list[i].frees,
+			list[i].bytes,ns/1000000000,ns%1000000000);
+	}
+
+	free(list);
+	return 0;
+}
+
+static unsigned long long histvalue(HIST *hg,double pct)
+{
+	int i;
+	unsigned long long v;
+	unsigned long long rank;
+	unsigned long long sum=0;
+
+	if(!hg->total)return 0;
+	if(pct>=100)rank=hg->total;
+	else if(!(rank=(unsigned long long)(pct*hg->total/100+0.999999)))
+		rank=1;
+
+	for(i=0;i<((65-histbits)<<histbits);i++)
+		if((sum+=hg->count[i])>=rank)break;
+
+	i++;
+	if(!(i>>histbits))v=i;
+	else v=(unsigned long long)((1<<histbits)|(i&((1<<histbits)-1)))<<
+		((i>>histbits)-1);
+	v--;
+	if(hg->max&&v>hg->max)v=hg->max;
+	return ticks2ns(v);
+}
+
+static int histsort(const void *p1, const void *p2)
+{
+	const HIST **h1=(const HIST **)p1;
+	const HIST **h2=(const HIST **)p2;
+
+	if((*h1)->pct[0]<(*h2)->pct[0])return 1;
+	if((*h1)->pct[0]>(*h2)->pct[0])return -1;
+	if((*h1)->func<(*h2)->func)return -1;
+	if((*h1)->func>(*h2)->func)return 1;
+	return 0;
+}
+
+static int histproc(char *pct,int brief)
+{
+	int i;
+	int l;
+	double p;
+	HIST *hg;
+	HIST **list;
+	static const double q[4]={50,90,99,99.9};
+
+	if(!strcmp(pct,"max"))p=100;
+	else if((p=atof(pct))<=0||p>100)
+	{
+		fprintf(stderr,"illegal percentile %s\n",pct);
+		return -1;
+	}
+
+	if(!histtotal)
+	{
+		fprintf(stderr,"no histograms recorded, set PROFILE_HISTOGRAM"
+			" when profiling\n");
+		return -1;
+	}
+
+	if(!(list=malloc(histtotal*sizeof(HIST *))))
+	{
+		perror("malloc");
+		return -1;
+	}
+
+	for(i=0,hg=hists;i<histtotal;i++,hg=hg->next)
+	{
+		list[i]=hg;
+		hg->pct[0]=histvalue(hg,p);
+	}
+
+	qsort(list,histtotal,sizeof(HIST *),histsort);
+
+	if(p==100)printf("\nFunctions sorted by maximum call time:\n\n");
+	else printf("\nFunctions sorted by p%g call time:\n\n",p);
+
+	printf("Function                                    "
+		"Calls   p50 usec   p90 usec   p99 usec p99.9 usec   max usec\n");
+	printf("============================================"
+		"===========================================================\n");
+	for(i=0;i<histtotal;i++)
+	{
+		hg=list[i];
+		if(hg->funcdata)
+		{
+			if(!hg->funcdata->line)l=printf("%s (%s) ",
+				hg->funcdata->func,hg->funcdata->file);
+			else l=printf("%s (%s:%d) ",hg->funcdata->func,
+				hg->funcdata->file,hg->funcdata->line);
+		}
+		else if(hg->funcmap)l=printf("%s+%p ",brief?hg->funcmap->brief:
+			hg->funcmap->file,(void *)(hg->func-hg->funcmap->start));
+		else l=printf("%p ",(void *)hg->func);
+
+		while(l<32)l+=printf("          ");
+		while(l<42)l+=printf(" ");
+
+		printf(" %7llu",hg->total);
+		for(l=0;l<4;l++)
+		{
+			hg->pct[l]=histvalue(hg,q[l]);
+			printf(" %6llu.%03llu",hg->pct[l]/1000,hg->pct[l]%1000);
+		}
+		hg->pct[4]=histvalue(hg,100);
+		printf(" %6llu.%03llu\n",hg->pct[4]/1000,hg->pct[4]%1000);
+	}
+
+	free(list);
+	return 0;
+}
+
+static int jobcallsort(const void *p1, const void *p2)
+{
+	const THREAD **j1=(const THREAD **)p1;
+	const THREAD **j2=(const THREAD **)p2;
+
+	if((*j1)->calls<(*j2)->calls)return 1;
+	if((*j1)->calls>(*j2)->calls)return -1;
+	if((*j1)->func<(*j2)->func)return -1;
+	if((*j1)->func>(*j2)->func)return 1;
+	return 0;
+}
+
+static int jobcpusort(const void *p1, const void *p2)
+{
+	const THREAD **j1=(const THREAD **)p1;
+	const THREAD **j2=(const THREAD **)p2;
+
+	if((*j1)->nsecs<(*j2)->nsecs)return 1;
+	if((*j1)->nsecs>(*j2)->nsecs)return -1;
+	if((*j1)->func<(*j2)->func)return -1;
+	if((*j1)->func>(*j2)->func)return 1;
+	return 0;
+}
+
+static int jobavgcpusort(const void *p1, const void *p2)
+{
+	const THREAD **j1=(const THREAD **)p1;
+	const THREAD **j2=(const THREAD **)p2;
+
+	if((*j1)->avg<(*j2)->avg)return 1;
+	if((*j1)->avg>(*j2)->avg)return -1;
+	if((*j1)->func<(*j2)->func)return -1;
+	if((*j1)->func>(*j2)->func)return 1;
+	return 0;
+}
+
+static int jobsproc(int mode,int brief)
+{
+	int i;
+	int l;
+
+	switch(mode)
+	{
+	case 0:	printf("\nThreads sorted by amount of calls:\n\n");
+		qsort(sortedjobs,jobstotal,sizeof(THREAD *),jobcallsort);
 		break;
 
 	case 1: printf("\nThreads sorted by CPU usage:\n\n");
@@ -897,24 +2387,136 @@ static int jobsproc(int mode,int brief)
 		}
 		else if(sortedjobs[i]->funcmap)
 		{
-			l=printf("%s+%p ",brief?sortedjobs[i]->funcmap->brief:
-				sortedjobs[i]->funcmap->file,
-				(void *)(sortedjobs[i]->func-
-				sortedjobs[i]->funcmap->start));
+			l=printf("%s+%p ",brief?sortedjobs[i]->funcmap->brief:
+				sortedjobs[i]->funcmap->file,
+				(void *)(sortedjobs[i]->func-
+				sortedjobs[i]->funcmap->start));
+		}
+		else l=printf("%p ",(void *)(sortedjobs[i]->func));
+
+		while(l<43)l+=printf("          ");
+		while(l<53)l+=printf(" ");
+
+		if(mode<2)printf(" %7llu %7llu.%09llu\n",sortedjobs[i]->calls,
+			sortedjobs[i]->nsecs/1000000000,
+			sortedjobs[i]->nsecs%1000000000);
+		else printf(" %7llu %7llu.%09llu\n",sortedjobs[i]->calls,
+			sortedjobs[i]->avg/1000000000,
+			sortedjobs[i]->avg%1000000000);
+	}
+
+	return 0;
+}
+
+static int taskcpusort(const void *p1, const void *p2)
+{
+	const TASK **t1=(const TASK **)p1;
+	const TASK **t2=(const TASK **)p2;
+
+	if((*t1)->nsecs<(*t2)->nsecs)return 1;
+	if((*t1)->nsecs>(*t2)->nsecs)return -1;
+	if((*t1)->tid<(*t2)->tid)return -1;
+	if((*t1)->tid>(*t2)->tid)return 1;
+	return 0;
+}
+
+static int taskpatternsort(const void *p1, const void *p2)
+{
+	const TASK **t1=(const TASK **)p1;
+	const TASK **t2=(const TASK **)p2;
+
+	return strcmp((*t1)->pattern,(*t2)->pattern);
+}
+
+static int taskgroupsort(const void *p1, const void *p2)
+{
+	const TASK *t1=p1;
+	const TASK *t2=p2;
+
+	if(t1->nsecs<t2->nsecs)return 1;
+	if(t1->nsecs>t2->nsecs)return -1;
+	return strcmp(t1->pattern,t2->pattern);
+}
+
+static int tasksproc(int mode)
+{
+	int i;
+	int total;
+	TASK *list;
+	char bfr[64];
+
+	if(!taskstotal)
+	{
+		fprintf(stderr,"no per thread data recorded\n");
+		return -1;
+	}
+
+	if(!mode)
+	{
+		printf("\nThreads sorted by CPU usage:\n\n");
+		qsort(sortedtasks,taskstotal,sizeof(TASK *),taskcpusort);
+		printf("%-53s   Calls         CPU Usage  Depth"
+			"          Lifetime\n","Thread");
+		printf("======================================================="
+			"=============================================="
+			"===\n");
+		for(i=0;i<taskstotal;i++)
+		{
+			if(sortedtasks[i]->threads>1)snprintf(bfr,sizeof(bfr),
+				"%u threads (%s)",sortedtasks[i]->threads,
+				sortedtasks[i]->name);
+			else snprintf(bfr,sizeof(bfr),"%d (%s)",
+				sortedtasks[i]->tid,sortedtasks[i]->name);
+			printf("%-53s %7llu %7llu.%09llu %6llu %7llu.%09llu\n",
+				bfr,sortedtasks[i]->funcs,
+				sortedtasks[i]->nsecs/1000000000,
+				sortedtasks[i]->nsecs%1000000000,
+				sortedtasks[i]->depth,
+				sortedtasks[i]->lifetime/1000000000,
+				sortedtasks[i]->lifetime%1000000000);
+		}
+		return 0;
+	}
+
+	if(!(list=malloc(taskstotal*sizeof(TASK))))
+	{
+		perror("malloc");
+		return -1;
+	}
+
+	qsort(sortedtasks,taskstotal,sizeof(TASK *),taskpatternsort);
+
+	for(i=0,total=0;i<taskstotal;i++)
+	{
+		if(i&&!strcmp(sortedtasks[i-1]->pattern,sortedtasks[i]->pattern))
+		{
+			list[total-1].id+=sortedtasks[i]->threads;
+			list[total-1].funcs+=sortedtasks[i]->funcs;
+			list[total-1].nsecs+=sortedtasks[i]->nsecs;
+			if(sortedtasks[i]->maxtime>list[total-1].lifetime)
+				list[total-1].lifetime=sortedtasks[i]->maxtime;
+			continue;
 		}
-		else l=printf("%p ",(void *)(sortedjobs[i]->func));
+		list[total]=*sortedtasks[i];
+		list[total].id=sortedtasks[i]->threads;
+		list[total].lifetime=sortedtasks[i]->maxtime;
+		total++;
+	}
 
-		while(l<43)l+=printf("          ");
-		while(l<53)l+=printf(" ");
+	qsort(list,total,sizeof(TASK),taskgroupsort);
 
-		if(mode<2)printf(" %7llu %7llu.%09llu\n",sortedjobs[i]->calls,
-			sortedjobs[i]->nsecs/1000000000,
-			sortedjobs[i]->nsecs%1000000000);
-		else printf(" %7llu %7llu.%09llu\n",sortedjobs[i]->calls,
-			sortedjobs[i]->avg/1000000000,
-			sortedjobs[i]->avg%1000000000);
-	}
+	printf("\nThread groups (digits in thread names replaced by '*') "
+		"sorted by CPU usage:\n\n");
+	printf("%-53s Threads     Calls         CPU Usage        Max Thread\n",
+		"Thread Name");
+	printf("======================================================="
+		"====================================================\n");
+	for(i=0;i<total;i++)printf("%-53s %7d %9llu %7llu.%09llu "
+		"%7llu.%09llu\n",list[i].pattern,list[i].id,list[i].funcs,
+		list[i].nsecs/1000000000,list[i].nsecs%1000000000,
+		list[i].lifetime/1000000000,list[i].lifetime%1000000000);
 
+	free(list);
 	return 0;
 }
 
@@ -982,32 +2584,33 @@ static int search_func(int funcid)
 	}
 }
 
-static void fwalk(int idx,int level,int brief)
+static void fname(ADDR *funcdata,MAP *funcmap,unsigned long func,int level,
+	int brief)
 {
 	int i;
-	int funcid=sorted[idx]->funcid;
-	int callerid=-1;
-	int cidx;
 
 	for(i=0;i<level;i++)printf(" ");
-	if(sorted[idx]->funcdata)
-	{
-		if(!sorted[idx]->funcdata->line)printf("%s  (%s)\n",
-			sorted[idx]->funcdata->func,
-			sorted[idx]->funcdata->file);
-		else printf("%s  (%s:%d)\n",
-			sorted[idx]->funcdata->func,
-			sorted[idx]->funcdata->file,
-			sorted[idx]->funcdata->line);
-	}
-	else if(sorted[idx]->funcmap)
+	if(funcdata)
 	{
-		printf("%s+%p\n",brief?sorted[idx]->funcmap->brief:
-				sorted[idx]->funcmap->file,
-				(void *)(sorted[idx]->func-
-				sorted[idx]->funcmap->start));
+		if(!funcdata->line)printf("%s  (%s)",funcdata->func,
+			funcdata->file);
+		else printf("%s  (%s:%d)",funcdata->func,funcdata->file,
+			funcdata->line);
 	}
-	else printf("%p\n",(void *)sorted[idx]->func);
+	else if(funcmap)printf("%s+%p",brief?funcmap->brief:funcmap->file,
+		(void *)(func-funcmap->start));
+	else printf("%p",(void *)func);
+}
+
+static void fwalk(int idx,int level,int brief)
+{
+	int funcid=sorted[idx]->funcid;
+	int callerid=-1;
+	int cidx;
+
+	fname(sorted[idx]->funcdata,sorted[idx]->funcmap,sorted[idx]->func,
+		level,brief);
+	printf("\n");
 
 	while(idx<tracetotal&&sorted[idx]->funcid==funcid)
 	{
@@ -1025,10 +2628,72 @@ static void fwalk(int idx,int level,int brief)
 	}
 }
 
+static void nprint(NODE *n,int level,int brief)
+{
+	fname(n->funcdata,n->funcmap,n->func,level,brief);
+	printf("  [%llu calls, %llu.%09llu self, %llu.%09llu total]\n",
+		n->calls,n->nsecs/1000000000,n->nsecs%1000000000,
+		n->total/1000000000,n->total%1000000000);
+}
+
+static void nwalk(NODE *n,int level,int brief)
+{
+	nprint(n,level,brief);
+	for(n=n->child;n;n=n->sibling)nwalk(n,level+2,brief);
+}
+
+static int npath(NODE *n,int brief)
+{
+	int level;
+
+	if(!n->parent)level=2;
+	else level=npath(n->parent,brief)+2;
+	nprint(n,level,brief);
+	return level;
+}
+
+static int cctree(char *func,int brief)
+{
+	int i;
+	int found=0;
+
+	if(!func)printf("\nComplete calling context tree:\n");
+	else printf("\nCalling contexts of %s:\n",func);
+
+	for(i=0;i<nodestotal;i++)
+	{
+		if(!func)
+		{
+			if(sortednodes[i]->parentid)continue;
+			if(!i||sortednodes[i-1]->thread!=
+				sortednodes[i]->thread)
+					printf("\nThread %d:\n\n",
+						sortednodes[i]->thread);
+			nwalk(sortednodes[i],2,brief);
+		}
+		else if(sortednodes[i]->funcdata&&
+			!strcmp(func,sortednodes[i]->funcdata->func))
+		{
+			printf("\nThread %d:\n\n",sortednodes[i]->thread);
+			if(sortednodes[i]->parent)
+				nwalk(sortednodes[i],
+					npath(sortednodes[i]->parent,brief)+2,
+					brief);
+			else nwalk(sortednodes[i],2,brief);
+			found=1;
+		}
+	}
+
+	if(func&&!found)return -1;
+	return 0;
+}
+
 static int tree(char *func,int brief)
 {
 	int i;
 
+	if(nodestotal)return cctree(func,brief);
+
 	if(!func)printf("\nComplete function call tree:\n\n");
 	else printf("\nFunction call tree for %s:\n\n",func);
 
@@ -1060,13 +2725,16 @@ static int summary(int brief)
 	unsigned long long d=0;
 	unsigned long long n=0;
 	unsigned long long c=0;
+	unsigned long long o=0;
 	char *ptr;
 
 	for(i=0;i<tracetotal;i++)
 	{
 		n+=sorted[i]->nsecs;
 		c+=sorted[i]->calls;
+		o+=sorted[i]->overhead;
 	}
+	o=ticks2ns(o);
 
 	for(i=0;i<jobstotal;i++)
 		if(sortedjobs[i]->depth>d)d=sortedjobs[i]->depth;
@@ -1083,31 +2751,459 @@ static int summary(int brief)
 		}
 		printf("Command: %s\n",ptr);
 	}
+	if(pid)printf("Process: %d (parent %d)\n",pid,ppid);
+	if(windows==1)printf("Window: %d (%llu.%09llu - %llu.%09llu seconds)\n",
+		windowfirst,windowstart/1000000000,windowstart%1000000000,
+		windowend/1000000000,windowend%1000000000);
+	else if(windows)printf("Windows: %d-%d (%llu.%09llu - %llu.%09llu "
+		"seconds)\n",windowfirst,windowlast,windowstart/1000000000,
+		windowstart%1000000000,windowend/1000000000,
+		windowend%1000000000);
 	printf("Total run time: %llu.%09llu seconds\n",runtime/1000000000,
 		runtime%1000000000);
 	printf("Total CPU time: %llu.%09llu seconds\n",cpuuse/1000000000,
 		cpuuse%1000000000);
+	if(clockfreq==1000000000ULL)printf("Profiling clock: %s\n",clockname);
+	else printf("Profiling clock: %s (%llu.%06llu MHz)\n",clockname,
+		clockfreq/1000000,clockfreq%1000000);
+	if(*clockfallback)printf("Requested clock unusable: %s\n",
+		clockfallback);
+	if(clockthreads)printf("Threads using clock fallback: %d\n",
+		clockthreads);
+	if(eventtotal)
+	{
+		printf("Recorded events:");
+		for(i=0;i<eventtotal;i++)printf("%c%s",i?',':' ',eventname[i]);
+		printf("\n");
+	}
+	if(*eventfail)printf("Events unavailable: %s\n",eventfail);
+	if(eventthreads)printf("Threads without events: %d\n",eventthreads);
+	if(heaps)
+	{
+		unsigned long long a=0;
+		unsigned long long f=0;
+		unsigned long long b=0;
+		HEAP *hp;
+
+		for(hp=heaps;hp;hp=hp->next)
+		{
+			a+=hp->allocs;
+			f+=hp->frees;
+			b+=hp->bytes;
+		}
+		printf("Heap allocations: %llu (%llu bytes, %llu frees)\n",a,b,
+			f);
+	}
 	printf("Profiled CPU time: %llu.%09llu seconds\n",n/1000000000,
 		n%1000000000);
+	printf("Profiler overhead: %llu.%09llu seconds (%llu ns per call)\n",
+		o/1000000000,o%1000000000,ticks2ns(overhead<<1));
 	printf("Total function calls profiled: %llu\n",c);
 	printf("Maximum parallelism: %d\n",maxthreads);
 	printf("Maximum resident set size: %llu kbytes\n",maxrss);
 	printf("Maximum profiling memory: %u kbytes\n",
-		(fmem+cmem+maxthreads*tmem+1023)>>10);
+		(fmem+cmem+smem+maxthreads*tmem+1023)>>10);
+	if(shards)printf("Per CPU counter shards: %d\n",shards);
+	if(cachehits+cachemisses)
+		printf("Lookup cache hits: %llu/%llu (%llu%%)\n",cachehits,
+			cachehits+cachemisses,
+			cachehits*100/(cachehits+cachemisses));
+	if(recovered)printf("Unbalanced exits recovered: %llu\n",recovered);
 	printf("Function pool usage: %u/%u\n",fpool,fsize);
 	printf("Caller pool usage: %u/%u\n",cpool,csize);
-	printf("Stack usage: %llu/%u\n",d,ssize);
+	if(!stacks)printf("Stack usage: %llu/%u\n",d,ssize);
+	else printf("Stack usage: %d/%d (initial %u, %d threads)\n",
+		stackdepth,stackframes,ssize,stacks);
+	return 0;
+}
+
+static LIVE *livelist;
+static int livetotal;
+static int livesize;
+static int liveresolved;
+
+static int livesort(const void *p1, const void *p2)
+{
+	const LIVE **l1=(const LIVE **)p1;
+	const LIVE **l2=(const LIVE **)p2;
+
+	if((*l1)->dnsecs<(*l2)->dnsecs)return 1;
+	if((*l1)->dnsecs>(*l2)->dnsecs)return -1;
+	if((*l1)->dcalls<(*l2)->dcalls)return 1;
+	if((*l1)->dcalls>(*l2)->dcalls)return -1;
+	return 0;
+}
+
+static int livefuncsort(const void *p1, const void *p2)
+{
+	const LIVE *l1=p1;
+	const LIVE *l2=p2;
+
+	if(l1->func<l2->func)return -1;
+	if(l1->func>l2->func)return 1;
+	return 0;
+}
+
+static int livefind(unsigned long func)
+{
+	int i=0;
+	int j=liveresolved;
+	LIVE *l;
+	MAP *m;
+
+	while(i<j)
+	{
+		if(livelist[(i+j)>>1].func<func)i=((i+j)>>1)+1;
+		else j=(i+j)>>1;
+	}
+	if(i<liveresolved&&livelist[i].func==func)return i;
+
+	for(i=liveresolved;i<livetotal;i++)if(livelist[i].func==func)return i;
+
+	if(livetotal==livesize)
+	{
+		if(!(l=realloc(livelist,(livesize+1024)*sizeof(LIVE))))
+		{
+			perror("realloc");
+			return -1;
+		}
+		livelist=l;
+		livesize+=1024;
+	}
+
+	l=&livelist[livetotal];
+	memset(l,0,sizeof(LIVE));
+	l->func=func;
+	for(m=maps;m;m=m->next)if(func>=m->start&&func<m->end)
+	{
+		l->funcmap=m;
+		break;
+	}
+	return livetotal++;
+}
+
+static int liveresolve(int mode)
+{
+	int i;
+	TRACE *t;
+
+	if(!(t=calloc(livetotal,sizeof(TRACE))))
+	{
+		perror("malloc");
+		return -1;
+	}
+
+	for(i=0;i<livetotal;i++)
+	{
+		t[i].func=livelist[i].func;
+		t[i].next=data;
+		data=&t[i];
+	}
+	tracetotal=livetotal;
+
+	if(resolve(mode))return -1;
+
+	for(i=0;i<livetotal;i++)
+	{
+		livelist[i].funcdata=t[i].funcdata;
+		livelist[i].funcmap=t[i].funcmap;
+	}
+	return 0;
+}
+
+static int livescan(SHMHDR *h,int chunks,ELEM **elem)
+{
+	int i;
+	unsigned long j;
+	unsigned long used;
+	unsigned long func;
+	unsigned long long calls;
+	unsigned long long nsecs;
+	unsigned long long ovhd;
+	unsigned char *c;
+	unsigned char *e;
+	ELEM *el;
+	LIVE *l;
+
+	for(i=0;i<chunks;i++)
+	{
+		if(!h->chunk[i].pool)continue;
+		c=(unsigned char *)h+h->chunk[i].offset;
+		used=*(volatile unsigned long *)(c+h->chunkused);
+		if(used>*(unsigned long *)(c+h->chunksize))
+			used=*(unsigned long *)(c+h->chunksize);
+		if(!elem[i])
+		{
+			if(!(elem[i]=malloc(*(unsigned long *)(c+h->chunksize)*
+				sizeof(ELEM))))
+			{
+				perror("malloc");
+				return -1;
+			}
+			for(j=0;j<*(unsigned long *)(c+h->chunksize);j++)
+			{
+				elem[i][j].id=-1;
+				elem[i][j].calls=0;
+				elem[i][j].nsecs=0;
+			}
+		}
+
+		for(j=0;j<used;j++)
+		{
+			e=c+h->chunkdata+j*h->callersize;
+			el=&elem[i][j];
+			if(el->id==-1)
+			{
+				if(!(func=*(volatile unsigned long *)
+					(e+h->callerfunc)))continue;
+				if((el->id=livefind(func))==-1)return -1;
+			}
+			l=&livelist[el->id];
+
+			calls=*(volatile unsigned long long *)(e+h->callercalls);
+			nsecs=*(volatile unsigned long long *)(e+h->callertime);
+			ovhd=*(volatile unsigned long long *)
+				(e+h->calleroverhead);
+			nsecs=(ovhd>nsecs?0:nsecs-ovhd);
+
+			if(calls>el->calls)
+			{
+				l->dcalls+=calls-el->calls;
+				l->calls+=calls-el->calls;
+			}
+			if(nsecs>el->nsecs)
+			{
+				l->dnsecs+=nsecs-el->nsecs;
+				l->nsecs+=nsecs-el->nsecs;
+			}
+			el->calls=calls;
+			el->nsecs=nsecs;
+		}
+	}
+	return 0;
+}
+
+static int liveshow(SHMHDR *h,unsigned long long elapsed,int brief)
+{
+	int i;
+	int l;
+	int rows=20;
+	unsigned long long v;
+	LIVE **list;
+	struct winsize w;
+
+	if(!ioctl(1,TIOCGWINSZ,&w)&&w.ws_row>8)rows=w.ws_row-6;
+	if(!elapsed)elapsed=1;
+
+	if(!(list=malloc((livetotal+1)*sizeof(LIVE *))))
+	{
+		perror("malloc");
+		return -1;
+	}
+
+	for(i=0;i<livetotal;i++)list[i]=&livelist[i];
+
+	qsort(list,livetotal,sizeof(LIVE *),livesort);
+
+	printf("\033[H\033[2J");
+	printf("Process %d, clock %s, %d functions\n\n",h->pid,clockname,
+		livetotal);
+	printf("%-53s Calls/s  CPU %%          Calls         CPU Usage\n",
+		"Function");
+	printf("======================================================="
+		"==============================================\n");
+
+	for(i=0;i<livetotal&&i<rows;i++)
+	{
+		if(list[i]->funcdata)
+		{
+			if(!list[i]->funcdata->line)l=printf("%s (%s) ",
+				list[i]->funcdata->func,
+				list[i]->funcdata->file);
+			else l=printf("%s (%s:%d) ",list[i]->funcdata->func,
+				list[i]->funcdata->file,
+				list[i]->funcdata->line);
+		}
+		else if(list[i]->funcmap)
+		{
+			l=printf("%s+%p ",brief?list[i]->funcmap->brief:
+				list[i]->funcmap->file,(void *)(list[i]->func-
+				list[i]->funcmap->start));
+		}
+		else l=printf("%p ",(void *)list[i]->func);
+
+		while(l<43)l+=printf("          ");
+		while(l<53)l+=printf(" ");
+
+		v=ticks2ns(list[i]->dnsecs)*1000/elapsed;
+		printf(" %7llu %4llu.%01llu %14llu %7llu.%09llu\n",
+			list[i]->dcalls*1000000000/elapsed,v/10,v%10,
+			list[i]->calls,ticks2ns(list[i]->nsecs)/1000000000,
+			ticks2ns(list[i]->nsecs)%1000000000);
+	}
+
+	for(i=0;i<livetotal;i++)livelist[i].dcalls=livelist[i].dnsecs=0;
+
+	fflush(stdout);
+	free(list);
 	return 0;
 }
 
+static int liveview(char *name,int brief,char *pfx)
+{
+	int i;
+	int fd;
+	int chunks;
+	int ready=0;
+	int res=-1;
+	unsigned long start;
+	unsigned long end;
+	unsigned long long need;
+	unsigned long long size;
+	unsigned long long last;
+	unsigned long long now;
+	char *ptr;
+	char *line;
+	SHMHDR *h;
+	ELEM *elem[SHMCHUNKS];
+	struct stat stb;
+	struct timespec ts;
+	char bfr[PATH_MAX];
+
+	memset(elem,0,sizeof(elem));
+
+	if(strchr(name,'/'))
+	{
+		fprintf(stderr,"invalid shared memory name %s\n",name);
+		return -1;
+	}
+
+	snprintf(bfr,sizeof(bfr),"/dev/shm/%s",name);
+	if((fd=open(bfr,O_RDONLY|O_CLOEXEC))==-1)
+	{
+		perror(bfr);
+		return -1;
+	}
+	if(fstat(fd,&stb))
+	{
+		perror("fstat");
+		goto err1;
+	}
+	if(stb.st_size<sizeof(SHMHDR))
+	{
+		fprintf(stderr,"%s is not a profiler segment\n",bfr);
+		goto err1;
+	}
+	size=stb.st_size;
+	if((h=mmap(NULL,size,PROT_READ,MAP_SHARED,fd,0))==MAP_FAILED)
+	{
+		perror("mmap");
+		goto err1;
+	}
+
+	while(memcmp(h->magic,SHMMAGIC,sizeof(SHMMAGIC)))
+	{
+		if(h->version&&h->version!=SHMVERSION)break;
+		if(kill(h->pid,0)&&errno==ESRCH)break;
+		sleep(1);
+	}
+	if(memcmp(h->magic,SHMMAGIC,sizeof(SHMMAGIC))||
+		h->version!=SHMVERSION||h->size<sizeof(SHMHDR))
+	{
+		fprintf(stderr,"%s is not a profiler segment\n",bfr);
+		goto err2;
+	}
+
+	clockfreq=h->clockfreq?h->clockfreq:1000000000ULL;
+	overhead=h->overhead;
+	snprintf(clockname,sizeof(clockname),"%.*s",(int)sizeof(h->clock)-1,
+		h->clock);
+
+	for(line=h->maps;line<h->maps+SHMMAPS&&*line;line=ptr+1)
+	{
+		if(!(ptr=memchr(line,'\n',h->maps+SHMMAPS-line)))break;
+		if(ptr-line>=sizeof(bfr))continue;
+		memcpy(bfr,line,ptr-line);
+		bfr[ptr-line]=0;
+		if(strncmp(bfr,"MAP: ",5))continue;
+		start=strtoul(bfr+5,&line,16);
+		end=strtoul(line,&line,16);
+		if(*line++!=' '||!*line)continue;
+		if(newmap(start,end,line,pfx))goto err2;
+	}
+
+	while(1)
+	{
+		chunks=__atomic_load_n(&h->chunks,__ATOMIC_ACQUIRE);
+		if(chunks>SHMCHUNKS)chunks=SHMCHUNKS;
+		for(i=0,need=h->size;i<chunks;i++)
+			if(h->chunk[i].offset+h->chunk[i].size>need)
+				need=h->chunk[i].offset+h->chunk[i].size;
+		if(need>size)
+		{
+			munmap(h,size);
+			size=need;
+			if((h=mmap(NULL,size,PROT_READ,MAP_SHARED,fd,0))==
+				MAP_FAILED)
+			{
+				perror("mmap");
+				goto err1;
+			}
+		}
+
+		if(livescan(h,chunks,elem))goto err2;
+
+		if(!ready&&livetotal)
+		{
+			qsort(livelist,livetotal,sizeof(LIVE),livefuncsort);
+			for(i=0;i<SHMCHUNKS;i++)if(elem[i])
+			{
+				free(elem[i]);
+				elem[i]=NULL;
+			}
+			for(i=0;i<livetotal;i++)
+				livelist[i].calls=livelist[i].nsecs=0;
+			liveresolved=livetotal;
+			if(liveresolve(brief)||livescan(h,chunks,elem))
+				goto err2;
+			for(i=0;i<livetotal;i++)
+				livelist[i].dcalls=livelist[i].dnsecs=0;
+			ready=1;
+		}
+		else if(ready)
+		{
+			clock_gettime(CLOCK_MONOTONIC,&ts);
+			now=ts.tv_sec*1000000000ULL+ts.tv_nsec;
+			if(liveshow(h,now-last,brief))goto err2;
+		}
+		clock_gettime(CLOCK_MONOTONIC,&ts);
+		last=ts.tv_sec*1000000000ULL+ts.tv_nsec;
+
+		if(__atomic_load_n(&h->done,__ATOMIC_ACQUIRE)||
+			(kill(h->pid,0)&&errno==ESRCH))break;
+		sleep(1);
+	}
+
+	printf("\nProcess %d terminated.\n",h->pid);
+	res=0;
+
+err2:	munmap(h,size);
+err1:	close(fd);
+	for(i=0;i<SHMCHUNKS;i++)if(elem[i])free(elem[i]);
+	return res;
+}
+
 static void usage(void)
 {
 	fprintf(stderr,
 "Usage: profiler [-s] [-i instrumentation] [OPTIONS]\n"
+"       profiler [-s] [-p prefix] --live name\n"
 "\n"
 "Options:\n"
 "-s                 print only file name, not full path to file\n"
 "-i instrumentation profiling output, default is 'instrumentation.out'\n"
+"-r first[-last]    process snapshot window(s) <instrumentation>.<n> of a\n"
+"                   run with PROFILE_INTERVAL set\n"
 "-p <prefix>        process pathnames with chroot <prefix>\n"
 "-g <adjust>        clock_gettime correction in nanoseconds\n"
 "-S                 show summary\n"
@@ -1116,15 +3212,50 @@ static void usage(void)
 "-a                 list functions sorted by calls, show avg. cpu time per"
 	" call\n"
 "-A                 list functions sorted by average cpu time per call\n"
+"-l                 list functions sorted by total inclusive cpu time\n"
+"-L                 list functions sorted by average inclusive cpu time per"
+	" call\n"
+"-o                 list functions sorted by total off-cpu (wall minus cpu)"
+	" time\n"
+"-O                 list functions sorted by average off-cpu time per call\n"
+"-u                 list functions with forced unwinds (calls that did not\n"
+"                   return via the exit hook, e.g. left by longjmp or still\n"
+"                   active at exit) sorted by amount of unwinds\n"
+"-H percentile      list call time percentiles of functions sorted by the\n"
+"                   given percentile (e.g. 50, 99.9 or max)\n"
+"-e event           list functions sorted by total count of the recorded\n"
+"                   event (e.g. cache-misses), 'ipc' sorts by instructions\n"
+"                   per cycle, lowest first\n"
+"-E event           list functions sorted by average event count per call\n"
+"-b                 list functions sorted by allocated heap bytes\n"
+"-B                 list functions sorted by amount of heap allocations\n"
 "-t                 list threads sorted by amount of invocations\n"
 "-T                 list threads sorted by total cpu time used\n"
 "-w                 list threads sorted by invocations, avg. cpu time per"
 	" call\n"
 "-W                 list threads sorted by average cpu time per call\n"
+"-j                 list single threads (tid and name) sorted by total cpu"
+	" time\n"
+"-J                 list thread groups sorted by total cpu time, threads\n"
+"                   are grouped by name with digits replaced by '*'\n"
 "-f                 show complete function call tree(s)\n"
 "-F function        show function call tree for <function>\n"
+"--live name        attach to the shared memory segment <name> of a process\n"
+"                   running with PROFILE_SHM=<name> and show its functions\n"
+"                   sorted by CPU usage of the last second, refreshed every\n"
+"                   second until the process terminates\n"
 "\n"
-"Note that call trees are based on actually executed calls.\n");
+"Note that the -t, -T, -w and -W thread lists are per thread start\n"
+"function, i.e. all threads running the same function are merged.\n"
+"Note that call trees are based on actually executed calls. If the\n"
+"instrumentation was recorded with PROFILE_MODE=cct the trees are exact\n"
+"calling context trees including cpu time per call path.\n"
+"Off-cpu times require the instrumentation to be recorded with\n"
+"PROFILE_WALLCLOCK set.\n"
+"Event counts require the instrumentation to be recorded with\n"
+"PROFILE_EVENTS set, they are self counts excluding callees.\n"
+"Heap allocations require the profiled code to be compiled with\n"
+"PROFILE_ALLOC defined.\n");
 	exit(1);
 }
 
@@ -1137,9 +3268,26 @@ int main(int argc,char *argv[])
 	int brief=0;
 	char *func=NULL;
 	char *pfx=NULL;
+	char *pct=NULL;
+	char *event=NULL;
+	char *avgevent=NULL;
+	char *ptr;
+	int first=-1;
+	int last=-1;
+	char *shm=NULL;
+	struct option opts[]=
+	{
+		{"live",required_argument,NULL,'m'},
+		{NULL,0,NULL,0}
+	};
 
-	while((c=getopt(argc,argv,"aAcCfF:g:i:p:sStTwW"))!=-1)switch(c)
+	while((c=getopt_long(argc,argv,"aAbBcCe:E:fF:g:H:i:jJlLoOp:r:sStTuwW",opts,
+		NULL))!=-1)switch(c)
 	{
+	case 'm':
+		shm=optarg;
+		break;
+
 	case 's':
 		brief=1;
 		break;
@@ -1197,22 +3345,93 @@ int main(int argc,char *argv[])
 		op|=1024;
 		break;
 
+	case 'l':
+		op|=2048;
+		break;
+
+	case 'L':
+		op|=4096;
+		break;
+
+	case 'o':
+		op|=16384;
+		break;
+
+	case 'O':
+		op|=32768;
+		break;
+
+	case 'u':
+		op|=262144;
+		break;
+
+	case 'j':
+		op|=65536;
+		break;
+
+	case 'J':
+		op|=131072;
+		break;
+
+	case 'H':
+		pct=optarg;
+		op|=8192;
+		break;
+
+	case 'b':
+		op|=2097152;
+		break;
+
+	case 'B':
+		op|=4194304;
+		break;
+
+	case 'e':
+		event=optarg;
+		op|=524288;
+		break;
+
+	case 'E':
+		avgevent=optarg;
+		op|=1048576;
+		break;
+
 	case 'i':
 		inst=optarg;
 		break;
 
+	case 'r':
+		first=last=atoi(optarg);
+		if((ptr=strchr(optarg,'-')))last=atoi(ptr+1);
+		if(first<0||last<first)usage();
+		break;
+
 	default:usage();
 	}
 
-	if(optind!=argc||!op||adj<0||adj>100000)usage();
+	if(optind!=argc||(!op&&!shm)||(op&&shm)||adj<0||adj>100000)usage();
+
+	if(shm)return liveview(shm,brief,pfx)?1:0;
 
-	if(readtrace(inst,brief,pfx))return 1;
+	if(readtrace(inst,brief,pfx,first,last))return 1;
 	if(adjust(adj))return 1;
 
 	if(op&1)if(tops(0,brief))return 1;
 	if(op&2)if(tops(1,brief))return 1;
 	if(op&4)if(tops(2,brief))return 1;
 	if(op&8)if(tops(3,brief))return 1;
+	if(op&2048)if(tops(4,brief))return 1;
+	if(op&4096)if(tops(5,brief))return 1;
+	if(op&16384)if(tops(6,brief))return 1;
+	if(op&32768)if(tops(7,brief))return 1;
+	if(op&262144)if(tops(8,brief))return 1;
+	if(op&8192)if(histproc(pct,brief))return 1;
+	if(op&524288)if(eventsproc(event,0,brief))return 1;
+	if(op&1048576)if(eventsproc(avgevent,1,brief))return 1;
+	if(op&2097152)if(heapproc(0,brief))return 1;
+	if(op&4194304)if(heapproc(1,brief))return 1;
+	if(op&65536)if(tasksproc(0))return 1;
+	if(op&131072)if(tasksproc(1))return 1;
 	if(op&16)if(jobsproc(0,brief))return 1;
 	if(op&32)if(jobsproc(1,brief))return 1;
 	if(op&64)if(jobsproc(2,brief))return 1;
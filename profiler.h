@@ -30,30 +30,248 @@
  *
  * Options passed via environment:
  *
- * PROFILE_LOG_FILE	instrumentation file, default "instrumentation.out"
- * PROFILE_STACK_SIZE	maximum instrumentation stack, default 100
- * PROFILE_FUNC_POOL	elements in function pool, default 1000
- * PROFILE_CALLER_POOL	elements in function caller pool, default 5000
+ * PROFILE_LOG_FILE	instrumentation file, default "instrumentation.out",
+ *			"%p" is replaced by the process id, "%t" by the time
+ *			in seconds since the epoch and "%%" by "%"
+ * PROFILE_STACK_SIZE	initial instrumentation stack, default 100
+ * PROFILE_FUNC_POOL	initial elements in function pool, default 1000
+ * PROFILE_CALLER_POOL	initial elements in function caller pool, default 5000
+ * PROFILE_NODE_POOL	initial elements in calling context pool, default 10000
  * PROFILE_DAEMON	write instrumentation only for child if set,
  *                      otherwise write instrumentation only for parent
  * PROFILE_DISABLE      disable profiling completely except for compiled in
  *                      stub calls.
+ * PROFILE_CLOCK	clock engine, one of "thread-cpu" (default), "task-clock",
+ *			"monotonic" or "tsc", unknown values fall back to
+ *			"thread-cpu" and are reported as clock-fallback
+ * PROFILE_OVERHEAD	profiler overhead per call transition in clock ticks,
+ *			default is measured at startup
+ * PROFILE_MODE		"shared" (default), "sharded" (pthreads only),
+ *			"private" (pthreads only) or "cct", see below
+ * PROFILE_HISTOGRAM	record per function call time histograms if set
+ * PROFILE_WALLCLOCK	additionally record wall clock time if set
+ * PROFILE_FORMAT	instrumentation file format, "text" (default) or
+ *			"binary"
+ * PROFILE_INTERVAL	snapshot interval in milliseconds (pthreads only),
+ *			default is no snapshots
+ * PROFILE_INTERVAL_FILES
+ *			amount of snapshot files kept, default 10
+ * PROFILE_CONTROL_SIGNAL
+ *			signal (number or name, e.g. "USR2") that causes a data
+ *			dump (pthreads only), default none
+ * PROFILE_CONTROL_SOCKET
+ *			pathname of a unix stream socket accepting control
+ *			commands (pthreads only), default none
+ * PROFILE_START_DELAY	milliseconds after startup until profiling starts
+ *			(pthreads only), default 0
+ * PROFILE_DURATION	milliseconds of profiling after the start delay
+ *			(pthreads only), default unlimited
+ * PROFILE_SHM		name of a shared memory segment in /dev/shm holding
+ *			the live counters ("shared" mode only), default none
+ * PROFILE_INCLUDE	comma separated list of functions to profile, each
+ *			entry is "symbol" or "object:symbol" (shell patterns,
+ *			an empty symbol selects the whole object), default all
+ * PROFILE_EXCLUDE	comma separated list of functions not to profile,
+ *			same format as PROFILE_INCLUDE, default none
+ * PROFILE_EVENTS	comma separated list of up to 4 perf events counted
+ *			per function caller (e.g. "cycles,instructions,
+ *			cache-misses"), default none, unknown or excess
+ *			names are reported as unavailable
  *
  * The instrumentation file gets the profiling data written to when the
  * executable terminates.
+ * By default only the parent (or with PROFILE_DAEMON only the child) of
+ * a fork writes the instrumentation file. If the file name contains
+ * "%p" every process writes its own file instead. A fork handler
+ * clears all counters in the child and drops all threads except the
+ * one that called fork, the snapshot and control thread is not running
+ * in the child. The process id and the parent process id are recorded
+ * so that the files can be related.
+ * The text format is one line per record. The binary format starts with
+ * a versioned header followed by fixed size function caller and function
+ * records and the map table in host byte order, all other records follow
+ * as text. It is written in large chunks and mapped into memory by the
+ * profiler utility instead of being parsed line by line, which is much
+ * faster for large instrumentation data.
+ * For long running processes a background thread can write snapshots
+ * of the shared function and caller tables at a fixed interval. Every
+ * snapshot window is written as text to the instrumentation file name
+ * with the window number appended (e.g. "instrumentation.out.7") and
+ * contains only the counter deltas of this window. Only the given amount
+ * of most recent window files is kept, older ones are removed. The
+ * snapshot thread only reads the counters, thus the hooks don't wait for
+ * it, only incomplete calls are not yet accounted. In "private" and "cct"
+ * mode the shared tables only contain the data of terminated threads.
+ * The complete data is written at termination as usual.
+ * A running process can be controlled by the configured signal, which
+ * dumps the current data (note that the signal may interrupt system
+ * calls of the process like any other signal), or by sending one of the
+ * commands "dump", "reset", "pause" or "resume" to the control socket
+ * (one command per connection, the reply is "ok" or "failed"). "dump"
+ * writes the current shared table contents to the instrumentation file,
+ * "reset" clears all counters and histograms, "pause" and "resume" stop
+ * and restart the recording as profile_pause() and profile_resume() do
+ * (see below). The commands are executed by the snapshot thread. "reset"
+ * only ever subtracts what it has read before from the counters, so
+ * concurrently running hooks never lose any of their updates. In
+ * "private" and "cct" mode "reset" also reaches the tables and call trees
+ * of running threads, every thread clears its own at its next call or
+ * when it terminates, whatever comes first.
+ * The same can be done by the program itself with the (not instrumented)
+ * functions profile_pause(), profile_resume(), profile_reset() and
+ * profile_snapshot(path), the latter writes the current shared table
+ * contents to the given file, profile_reset() and profile_snapshot()
+ * return 0 on success and -1 on failure. While paused both hooks return
+ * after testing a single flag, so a paused process runs at nearly full
+ * speed. The instrumentation stacks are left as they are, resuming bumps
+ * a global epoch. profile_pause() charges the running function of the
+ * calling thread up to the pause and profile_resume() restarts the time
+ * keeping of the calling thread at once, so the paused time is not
+ * accounted to any function, even if the process is resumed deep inside
+ * a call chain. All other threads restart their time keeping at their
+ * next call transition, the time they run between the resume and this
+ * transition is lost (as is the time between their last transition and
+ * a pause). Calls that returned while paused are closed by the next
+ * return of an enclosing function without being counted as forced
+ * unwinds, calls made after the resume but before this return show up
+ * as called by them. Returns of calls made while paused are ignored.
+ * PROFILE_START_DELAY starts the process paused and lets the snapshot
+ * thread resume it after the delay, PROFILE_DURATION lets the snapshot
+ * thread pause it again after the given time. A forked child
+ * keeps the paused state but has no snapshot thread to change it.
+ * If a shared memory name is given the function and caller pools are
+ * allocated from a file in /dev/shm instead of anonymous memory. The
+ * file starts with a header describing the element layout, the clock,
+ * the overhead, the map table and a directory of all pool chunks, the
+ * chunks are appended as the pools grow. "profiler --live <name>" maps
+ * the file read only and shows the counter deltas of every second, the
+ * hooks don't notice the reader at all. The file is removed when the
+ * executable exits. This only works in "shared" mode as the "private"
+ * and "cct" modes don't update the shared tables while threads run.
  * The instrumentation stack is required for time keeping and each element
  * represents one call depth level. There is one instrumentation stack per
- * thread.
- * The function pool is the maximum amount of different functions that
- * can be instrumented.
- * The caller pool is the maximum amount of different function callers
- * prt function that can be instrumented.
- * If any of the above limits would be exceeded the whole profiling will
- * fail. This failure may cause profiler memory leaks.
+ * thread which is doubled in size whenever the call depth reaches its
+ * current size. The maximum call depth and stack size of every thread
+ * are recorded in the instrumentation file.
+ * Additionally every thread keeps its own totals of calls, CPU time and
+ * overhead which are recorded together with its kernel thread id, its
+ * name (as read by prctl(PR_GET_NAME), i.e. as set e.g. by
+ * pthread_setname_np) and its lifetime when the thread terminates or
+ * the executable exits. These records are pushed to a lock free list.
+ * After 1024 records further threads are aggregated per name pattern
+ * (digits replaced by '*') into one record each, so memory and output
+ * stay bounded for programs that create threads without end. In "cct"
+ * mode every thread keeps its own record as it owns a call tree.
+ * The buffers of a terminated thread (thread state, instrumentation
+ * stack and active call table) are not freed but put on a lock free
+ * list and reused by the next new thread, so short lived threads cost
+ * the clock setup and one record allocation (none once aggregated)
+ * plus some atomic operations. Without atomic operations the record
+ * handling takes the global mutex. Every buffer ever allocated gets a
+ * slot in a thread table that only grows and is walked when the
+ * executable exits.
+ * The function pool holds the different functions that are instrumented.
+ * The caller pool holds the different function callers per function
+ * that are instrumented.
+ * If memory for the stacks or the pools can't be allocated the whole
+ * profiling will fail. This failure may cause
+ * profiler memory leaks.
+ * Functions and function callers are found via open addressing hash
+ * tables sized to twice the pool sizes. Lookups are lock free, new
+ * entries are fully initialized and then published with a single
+ * compare and swap (unless PROFILE_NO_ATOMICS is defined in which case
+ * the global mutex protects the tables).
+ * The pools and the hash tables grow on demand, the pool sizes given
+ * are thus initial sizes only. Each pool grows by mmap'ed chunks of
+ * twice the size of the previous chunk, a hash table gets a chained
+ * table of twice the size when half full. New entries only go to the
+ * newest table, a lookup passing a free slot of an older table seals
+ * that slot, so an entry can never exist in two tables at once.
+ * Every thread caches recently used function callers in a small direct
+ * mapped cache so repeated calls from the same call site usually skip
+ * the hash table lookup. Cache hits and misses are recorded in the
+ * instrumentation file.
+ * The clock engine defines what is measured. "thread-cpu" is the thread
+ * CPU time as returned by the clock_gettime syscall and is the slowest
+ * engine. "task-clock" is thread CPU time, too, but read in user space
+ * from a per thread perf_event self monitoring page. If perf_event_open
+ * is not permitted or the kernel doesn't support user space time reads
+ * "task-clock" falls back to "thread-cpu", if this happens for a single
+ * thread only, this thread silently uses "thread-cpu" instead.
+ * "monotonic" is wall clock time via vDSO. "tsc" reads the time
+ * stamp counter (x86 only) which is wall clock time at lowest cost, its
+ * frequency is calibrated at startup. If the time stamp counter is not
+ * invariant "tsc" falls back to "monotonic". The engine used and its
+ * frequency are recorded in the instrumentation file and all times in
+ * the instrumentation file are in clock ticks of this engine.
+ * Besides the time spent in a function itself (self time) the time
+ * including all called functions (inclusive time) is recorded per
+ * function caller. For recursive functions only the outermost active
+ * call of the function is accounted inclusive time so recursion is not
+ * counted twice.
+ * If enabled a log-linear histogram of the inclusive time of every
+ * single call is kept per function, each power of two is divided into
+ * 8 buckets. This allows for latency percentiles but costs about 4KB per
+ * function and some additional processing per call.
+ * If events are configured every thread opens a perf_event group of
+ * these events when it makes its first call. The counters are read at
+ * every call transition, on x86 with rdpmc from the self monitoring
+ * pages if the kernel allows it, otherwise with a read of the group,
+ * and the deltas are added to the function caller that was running, so
+ * the counts are self counts excluding callees and including a part of
+ * the profiler's own bookkeeping. If the events can't be opened they
+ * are retried for user space only, if this fails, too, events are
+ * disabled and the instrumentation file tells so. Threads that can't
+ * open the group are counted and record no events. Event counts are
+ * part of snapshots and interval files and are cleared by "reset" like
+ * all other counters.
+ * If enabled and the clock engine measures thread CPU time a second
+ * monotonic wall clock is read alongside and the wall clock time of
+ * every function caller is recorded in nanoseconds, too. The difference
+ * to the CPU time is the time a function spent off CPU, e.g. blocked in
+ * I/O, waiting for a lock or preempted. For the wall clock engines
+ * "monotonic" and "tsc" this option is ignored.
+ * The clock is read once per function entry and exit. The time between
+ * two reads thus contains the profiler's own bookkeeping for one call
+ * transition. This overhead is measured at startup by running the hooks
+ * in a loop and is then accounted per caller and per thread separately
+ * from the measured time so the profiler can subtract it.
+ * In "shared" mode all threads update common function and caller tables
+ * using atomic operations (or the global mutex). In "private" mode each
+ * thread updates its own tables with plain stores and the tables are
+ * merged when the thread terminates or the executable exits. This scales
+ * better with many threads running the same code at the cost of more
+ * function and caller pool elements being used. A terminated thread's
+ * tables are cleared by the merge and kept for the next thread reusing
+ * its buffers, so the cost is bounded by the maximum number of
+ * concurrently running threads, not by the number of threads created.
+ * In "sharded" mode the tables are shared as in "shared" mode but the
+ * per call counters of every function caller are kept in one cache line
+ * per CPU. The hooks add to the line of the CPU they are running on (as
+ * told by rseq if glibc registered it, otherwise by sched_getcpu), so
+ * threads calling the same function on different CPUs don't contend for
+ * the same cache line. The lines are folded into the caller counters
+ * whenever the data is dumped or a snapshot is taken. This costs 64
+ * bytes per CPU and function caller. As the live counters in shared
+ * memory would only show folded values, PROFILE_SHM is ignored in this
+ * mode. Without atomic operations "sharded" mode is "shared" mode.
+ * In "cct" mode each thread records a calling context tree instead, i.e.
+ * every distinct call path gets its own node with its own counters. The
+ * children of a node are found via a per node hash table. The tree nodes
+ * are written to the instrumentation file as well as folded into the
+ * function and caller tables (as in "private" mode) so that all other
+ * evaluations stay available. The calling context pool holds the tree
+ * nodes of all threads.
  *
- * Important: If longjmp or siglongjmp are called this code will utterly
- * fail. You have been warned. Do not profile beyond setjmp/sigsetjmp.
- * If you call _exit or _Exit profiling will fail, too.
+ * Every stack element records the function address. If a function exit
+ * doesn't match the innermost active call, e.g. after longjmp or
+ * siglongjmp skipped some instrumented functions, the skipped calls
+ * are unwound up to the matching call and are recorded as forced
+ * unwinds (an exit without any matching call is ignored). The time
+ * between the jump and the next call transition is charged to the
+ * wrong function, though. C++ exceptions are no problem as gcc calls
+ * the exit hook when unwinding.
+ * Important: If you call _exit or _Exit profiling will fail.
  * If you call exit while threads are active you will lose some or all
  * cpu usage information for the call stack of every thread.
  * The same is true for terminatimg signals.
@@ -64,6 +282,17 @@
  * -finstrument-functions-exclude-function-list option of gcc or you
  * can use __attribute__((no_instrument_function)) in the function
  * declaration.
+ * Without recompiling PROFILE_INCLUDE and PROFILE_EXCLUDE select the
+ * functions to profile at runtime. The patterns are matched against the
+ * (mangled) function symbols of the symbol tables of every executable
+ * object mapped at startup, an "object:" prefix restricts an entry to
+ * objects whose file name (or pathname if the pattern contains a slash)
+ * matches, "object:" alone selects every address of the matching
+ * objects, e.g. "libz.so*:" for a whole library. The
+ * matches are turned into a sorted address range table once, the hooks
+ * of a function that is not included or is excluded return before the
+ * clock is read and its time is accounted to the calling function.
+ * Functions of objects loaded later (dlopen) never match.
  *
  * Below are some options you can define before including this header:
  *
@@ -81,28 +310,94 @@
  * usually do not fail (causes minimal slower code):
  *
  * #define PROFILE_STRICT
+ *
+ * Define, if you want heap allocations to be attributed to the calling
+ * functions (glibc only, see below):
+ *
+ * #define PROFILE_ALLOC
+ *
+ * With PROFILE_ALLOC defined the header additionally defines malloc,
+ * calloc, realloc, memalign, aligned_alloc, posix_memalign, valloc,
+ * pvalloc and free which forward to the glibc allocator. As the
+ * definitions are part of the executable they replace the allocator
+ * functions for all libraries, too, so operator new of C++ programs,
+ * which allocates via malloc, is covered as well (the header itself
+ * can't be compiled as C++, include it in a C source of the program).
+ * Every allocation and free made while an instrumented function is on
+ * top of the instrumentation stack of the current thread is counted
+ * together with the requested bytes and the clock ticks spent in the
+ * allocator in the stack frame of this function, realloc counts as an
+ * allocation of the new size. The frame totals are added to the function
+ * caller when the function returns, so the allocator wrappers never
+ * need atomics or locks. Allocations of threads without instrumented
+ * function calls, while paused and while the instrumentation is written
+ * are not recorded. Allocation counts are part of snapshots and interval
+ * files and are cleared by "reset" like all other counters. Note that
+ * with the "thread-cpu" clock every allocation costs two additional
+ * clock_gettime system calls. The cost of these two clock reads is
+ * calibrated at startup and accounted as profiler overhead of the
+ * calling function.
  */
 
 #include <sys/types.h>
+#include <sys/stat.h>
 #include <sys/resource.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/prctl.h>
+#include <linux/perf_event.h>
 #include <syscall.h>
 #include <sched.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <link.h>
+#include <poll.h>
 #include <limits.h>
+#include <signal.h>
+#include <errno.h>
+#include <stddef.h>
 #include <time.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
 #include <stdio.h>
 
-#define PROFILE_THREAD_TABLE_SIZE	64
-#define PROFILE_FUNC_TABLE_SIZE		64
+#if defined(__GLIBC__) && (__GLIBC__>2 || (__GLIBC__==2 && \
+	__GLIBC_MINOR__>=35)) && __GNUC__>=11 && \
+	(defined(__x86_64__) || defined(__aarch64__))
+#include <sys/rseq.h>
+#define PROFILE_HAVE_RSEQ
+#endif
 
-#if __SIZEOF_LONG__ > 4
-#define PROFILE_CALLER_TABLE_SIZE	8
-#else
-#define PROFILE_CALLER_TABLE_SIZE	16
+#ifndef _GNU_SOURCE
+extern int sched_getcpu(void);
 #endif
 
+#define PROFILE_THREAD_TABLE_SIZE	1024
+#define PROFILE_THREAD_BLOCK_SIZE	1024
+#define PROFILE_HASH_SLOTS		(64/(2*sizeof(unsigned long)))
+#define PROFILE_HASH_SEALED		((void *)1)
+#define PROFILE_OVERHEAD_LOOPS		1000
+#define PROFILE_CACHE_SIZE		256
+#define PROFILE_HIST_BITS		3
+#define PROFILE_EVENT_MAX		4
+#define PROFILE_TASK_LIMIT		1024
+#define PROFILE_HIST_MAX		((65-PROFILE_HIST_BITS)<<PROFILE_HIST_BITS)
+#define PROFILE_HIST_SIZE		(PROFILE_HIST_MAX+1)
+#define PROFILE_BIN_MAGIC		"PROFBIN"
+#define PROFILE_BIN_VERSION		1
+#define PROFILE_BIN_CHUNK		1048576
+#define PROFILE_SHM_MAGIC		"PROFSHM"
+#define PROFILE_SHM_VERSION		1
+#define PROFILE_SHM_CHUNKS		128
+#define PROFILE_SHM_MAPS		65536
+#define PROFILE_SNAP_CALLER		0
+#define PROFILE_SNAP_FUNC		1
+#define PROFILE_SNAP_EVENT		9
+#define PROFILE_SNAP_HEAP		(PROFILE_SNAP_EVENT+PROFILE_EVENT_MAX)
+#define PROFILE_SNAP_VALUES		(PROFILE_SNAP_HEAP+4)
+
 #define profile_nsecs(a) (((unsigned long long)(a).tv_sec)*1000000000ULL+\
 	((unsigned long long)(a).tv_nsec))
 
@@ -135,6 +430,34 @@ do								\
 }								\
 while(0)
 
+#define PROFILE_CLOCK_THREAD	0
+#define PROFILE_CLOCK_MONOTONIC	1
+#define PROFILE_CLOCK_TSC	2
+#define PROFILE_CLOCK_TSCP	3
+#define PROFILE_CLOCK_PERF	4
+
+#if defined(__x86_64__) || defined(__i386__)
+#define PROFILE_HAVE_TSC
+
+#define profile_cpuid(l,a,b,c,d)				\
+	__asm__ __volatile__("cpuid":"=a"(a),"=b"(b),"=c"(c),"=d"(d)	\
+		:"0"(l),"2"(0))
+#endif
+
+#ifdef PROFILE_ALLOC
+#define profile_alloc		1
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t n,size_t size);
+extern void *__libc_realloc(void *ptr,size_t size);
+extern void __libc_free(void *ptr);
+extern void *__libc_memalign(size_t alignment,size_t size);
+extern void *__libc_valloc(size_t size);
+extern void *__libc_pvalloc(size_t size);
+#else
+#define profile_alloc		0
+#endif
+
 #ifndef PROFILE_NO_ATOMICS
 
 #define lock(a)							\
@@ -150,6 +473,7 @@ __label__ done;							\
 								\
 		while(1)					\
 		{						\
+			z=0;					\
 			if(__atomic_compare_exchange_n((&a),	\
 				&z,1,1,__ATOMIC_SEQ_CST,	\
 				__ATOMIC_RELAXED))goto done;	\
@@ -178,22 +502,71 @@ while(0)
 
 #endif
 
+#if defined(_PTHREAD_H) && !defined(PROFILE_NO_ATOMICS)
+
+#define profile_load(a)		__atomic_load_n(&(a),__ATOMIC_ACQUIRE)
+#define profile_publish(a,b)	__atomic_store_n(&(a),(b),__ATOMIC_RELEASE)
+#define profile_claim(a,b,c)	__atomic_compare_exchange_n(&(a),&(b),(c),\
+					0,__ATOMIC_ACQ_REL,__ATOMIC_ACQUIRE)
+
+#else
+
+#define profile_load(a)		(a)
+#define profile_publish(a,b)	((a)=(b))
+#define profile_claim(a,b,c)	((a)==(b)?((a)=(c),1):((b)=(a),0))
+
+#endif
+
+typedef struct
+{
+	union
+	{
+		struct
+		{
+			unsigned long long calls;
+			unsigned long long time;
+			unsigned long long calling;
+			unsigned long long overhead;
+			unsigned long long incl;
+			unsigned long long incl_overhead;
+			unsigned long long incl_trans;
+			unsigned long long wall;
+		};
+		unsigned char align[64];
+	};
+} PROFILE_SHARD;
+
+typedef struct
+{
+	unsigned long long allocs;
+	unsigned long long frees;
+	unsigned long long bytes;
+	unsigned long long time;
+} PROFILE_HEAP;
+
 typedef struct profile_caller
 {
 	union
 	{
 		struct
 		{
-			struct profile_caller *left;
-			struct profile_caller *right;
+			struct profile_func *e;
+			void *func;
 			void *caller;
 			unsigned long long calls;
-			unsigned long long nsecs;
-			unsigned long long secs;
+			unsigned long long time;
 			unsigned long long calling;
 			unsigned int unwind;
+			unsigned long long overhead;
+			unsigned long long incl;
+			unsigned long long incl_overhead;
+			unsigned long long incl_trans;
+			unsigned long long wall;
+			PROFILE_SHARD *shard;
+			unsigned long long *events;
+			PROFILE_HEAP *heap;
 		};
-		unsigned char align[64];
+		unsigned char align[128];
 	};
 } PROFILE_CALLER;
 
@@ -203,21 +576,144 @@ typedef struct profile_func
 	{
 		struct
 		{
-			struct profile_func *left;
-			struct profile_func *right;
 			void *func;
-			PROFILE_CALLER *caller[PROFILE_CALLER_TABLE_SIZE];
 			unsigned long long calls;
 			unsigned long long funcs;
-			unsigned long long nsecs;
-			unsigned long long secs;
+			unsigned long long time;
 			unsigned int unwind;
 			unsigned int depth;
+			unsigned long long overhead;
+			unsigned long long *hist;
 		};
-		unsigned char align[128];
+		unsigned char align[64];
 	};
 } PROFILE_FUNC;
 
+typedef struct profile_node
+{
+	PROFILE_CALLER c;
+	union
+	{
+		struct
+		{
+			struct profile_node *parent;
+			struct profile_node *last;
+			struct profile_node **child;
+			struct profile_node *next;
+			unsigned int mask;
+			unsigned int used;
+			int id;
+		};
+		unsigned char align[64];
+	};
+} PROFILE_NODE;
+
+typedef struct
+{
+	union
+	{
+		struct
+		{
+			unsigned long tag[PROFILE_HASH_SLOTS];
+			void *item[PROFILE_HASH_SLOTS];
+		};
+		unsigned char align[64];
+	};
+} PROFILE_BUCKET;
+
+typedef struct profile_hash
+{
+	union
+	{
+		struct
+		{
+			struct profile_hash *next;
+			unsigned long mask;
+			unsigned long used;
+			unsigned long limit;
+		};
+		unsigned char align[64];
+	};
+	PROFILE_BUCKET bucket[0];
+} PROFILE_HASH;
+
+typedef struct
+{
+	PROFILE_HASH *func;
+	PROFILE_HASH *caller;
+} PROFILE_TABLES;
+
+typedef struct
+{
+	unsigned long start;
+	unsigned long end;
+} PROFILE_RANGE;
+
+typedef struct profile_chunk
+{
+	union
+	{
+		struct
+		{
+			struct profile_chunk *next;
+			unsigned long size;
+			unsigned long used;
+		};
+		unsigned char align[64];
+	};
+	unsigned char data[0];
+} PROFILE_CHUNK;
+
+typedef struct
+{
+	PROFILE_CHUNK *chunk;
+	unsigned long elsize;
+	unsigned long size;
+	int shared;
+} PROFILE_POOL;
+
+typedef struct
+{
+	unsigned long long offset;
+	unsigned long long size;
+	int pool;
+	int pad;
+} PROFILE_SHM_CHUNK;
+
+typedef struct
+{
+	char magic[8];
+	unsigned int version;
+	unsigned int size;
+	int pid;
+	int done;
+	int chunks;
+	unsigned int chunkdata;
+	unsigned int chunksize;
+	unsigned int chunkused;
+	unsigned int funcsize;
+	unsigned int callersize;
+	unsigned int callerfunc;
+	unsigned int callercaller;
+	unsigned int callercalls;
+	unsigned int callertime;
+	unsigned int calleroverhead;
+	unsigned int pad;
+	unsigned long long filesize;
+	unsigned long long clockfreq;
+	unsigned long long overhead;
+	char clock[16];
+	PROFILE_SHM_CHUNK chunk[PROFILE_SHM_CHUNKS];
+	char maps[PROFILE_SHM_MAPS];
+} PROFILE_SHM;
+
+typedef struct profile_active
+{
+	struct profile_active *next;
+	void *key;
+	unsigned int count;
+} PROFILE_ACTIVE;
+
 typedef struct
 {
 	union
@@ -226,9 +722,21 @@ typedef struct
 		{
 			PROFILE_FUNC *e;
 			PROFILE_CALLER *c;
-			struct timespec used;
+			unsigned long long used;
+			unsigned long long overhead;
+			unsigned long long time0;
+			unsigned long long overhead0;
+			unsigned long long funcs0;
+			PROFILE_ACTIVE *active;
+			unsigned long long wused;
+			void *func;
+			unsigned long long allocs;
+			unsigned long long frees;
+			unsigned long long abytes;
+			unsigned long long atime;
+			unsigned int epoch;
 		};
-		unsigned char align[32];
+		unsigned char align[128];
 	};
 } PROFILE_STACK;
 
@@ -239,318 +747,686 @@ typedef struct profile_thread
 		struct
 		{
 #ifdef _PTHREAD_H
-			struct profile_thread *next;
-			int table_index;
+			unsigned int table_index;
+			unsigned int free_next;
+			int busy;
 #endif
 			int stack_index;
+			int stack_size;
 			unsigned int unwind;
 			unsigned int depth;
+			unsigned int maxdepth;
+			int id;
 			unsigned long long funcs;
-			unsigned long long nsecs;
-			unsigned long long secs;
-			struct timespec start_time;
+			unsigned long long time;
+			unsigned long long overhead;
+			unsigned long long start_time;
+			struct perf_event_mmap_page *clock_page;
+			int clock_fd;
+			unsigned int epoch;
+			unsigned int reset;
+			PROFILE_STACK *stack;
+			unsigned long long cache_hits;
+			unsigned long long cache_misses;
+			unsigned long long wstart;
 		};
-		unsigned char align[64];
+		unsigned char align[128];
 	};
-	PROFILE_STACK stack[0];
+	PROFILE_CALLER *cache[PROFILE_CACHE_SIZE];
+	unsigned long long event_last[PROFILE_EVENT_MAX];
+	struct perf_event_mmap_page *event_page[PROFILE_EVENT_MAX];
+	int event_fd[PROFILE_EVENT_MAX];
+	int event_user;
+#ifdef _PTHREAD_H
+	PROFILE_TABLES tables;
+#endif
+	PROFILE_NODE *root;
+	PROFILE_NODE *nodes;
+	int node_count;
+	unsigned int active_mask;
+	unsigned int active_used;
+	PROFILE_ACTIVE **active;
+	PROFILE_ACTIVE *active_free;
+	unsigned long long sum_calls;
+	unsigned long long sum_funcs;
+	unsigned long long sum_time;
+	unsigned long long sum_overhead;
+	unsigned long long sum_unwind;
+	unsigned long long birth;
+	unsigned long long recovered;
+	int tid;
+	char name[16];
 } PROFILE_THREAD;
 
+typedef struct profile_task
+{
+	struct profile_task *next;
+	PROFILE_NODE *root;
+	PROFILE_NODE *nodes;
+	int id;
+	int tid;
+	unsigned long long depth;
+	unsigned long long frames;
+	unsigned long long calls;
+	unsigned long long funcs;
+	unsigned long long time;
+	unsigned long long overhead;
+	unsigned long long unwind;
+	unsigned long long lifetime;
+	unsigned long long maxtime;
+	unsigned int threads;
+	char name[16];
+} PROFILE_TASK;
+
+typedef struct
+{
+	char magic[8];
+	unsigned int version;
+	unsigned int size;
+	unsigned int callersize;
+	unsigned int funcsize;
+	unsigned long long callers;
+	unsigned long long funcs;
+	unsigned long long maps;
+	unsigned long long calleroff;
+	unsigned long long funcoff;
+	unsigned long long mapoff;
+	unsigned long long textoff;
+} PROFILE_BIN_HEADER;
+
+typedef struct
+{
+	unsigned long long func;
+	unsigned long long caller;
+	unsigned long long calls;
+	unsigned long long time;
+	unsigned long long calling;
+	unsigned long long unwind;
+	unsigned long long overhead;
+	unsigned long long incl;
+	unsigned long long incl_overhead;
+	unsigned long long incl_trans;
+	unsigned long long wall;
+} PROFILE_BIN_CALLER;
+
+typedef struct
+{
+	unsigned long long func;
+	unsigned long long calls;
+	unsigned long long time;
+	unsigned long long funcs;
+	unsigned long long overhead;
+	unsigned int unwind;
+	unsigned int depth;
+} PROFILE_BIN_FUNC;
+
+typedef struct
+{
+	unsigned long long start;
+	unsigned long long end;
+	unsigned int size;
+	unsigned int len;
+	char file[0];
+} PROFILE_BIN_MAP;
+
+typedef struct
+{
+	void *item;
+	void *func;
+	void *caller;
+	int type;
+	unsigned long long v[PROFILE_SNAP_VALUES];
+} PROFILE_SNAP;
+
+typedef struct
+{
+	const char *name;
+	unsigned int type;
+	unsigned long long config;
+} PROFILE_EVENT;
+
+#define PROFILE_EVENT_CACHE(a,b)	(PERF_COUNT_HW_CACHE_##a|		\
+	(PERF_COUNT_HW_CACHE_OP_READ<<8)|(PERF_COUNT_HW_CACHE_RESULT_##b<<16))
+
+static const PROFILE_EVENT profile_event_list[]=
+{
+	{"cycles",PERF_TYPE_HARDWARE,PERF_COUNT_HW_CPU_CYCLES},
+	{"instructions",PERF_TYPE_HARDWARE,PERF_COUNT_HW_INSTRUCTIONS},
+	{"cache-references",PERF_TYPE_HARDWARE,PERF_COUNT_HW_CACHE_REFERENCES},
+	{"cache-misses",PERF_TYPE_HARDWARE,PERF_COUNT_HW_CACHE_MISSES},
+	{"branches",PERF_TYPE_HARDWARE,PERF_COUNT_HW_BRANCH_INSTRUCTIONS},
+	{"branch-misses",PERF_TYPE_HARDWARE,PERF_COUNT_HW_BRANCH_MISSES},
+	{"bus-cycles",PERF_TYPE_HARDWARE,PERF_COUNT_HW_BUS_CYCLES},
+	{"stalled-cycles-frontend",PERF_TYPE_HARDWARE,
+		PERF_COUNT_HW_STALLED_CYCLES_FRONTEND},
+	{"stalled-cycles-backend",PERF_TYPE_HARDWARE,
+		PERF_COUNT_HW_STALLED_CYCLES_BACKEND},
+	{"ref-cycles",PERF_TYPE_HARDWARE,PERF_COUNT_HW_REF_CPU_CYCLES},
+	{"L1-dcache-loads",PERF_TYPE_HW_CACHE,PROFILE_EVENT_CACHE(L1D,ACCESS)},
+	{"L1-dcache-load-misses",PERF_TYPE_HW_CACHE,
+		PROFILE_EVENT_CACHE(L1D,MISS)},
+	{"LLC-loads",PERF_TYPE_HW_CACHE,PROFILE_EVENT_CACHE(LL,ACCESS)},
+	{"LLC-load-misses",PERF_TYPE_HW_CACHE,PROFILE_EVENT_CACHE(LL,MISS)},
+	{"dTLB-load-misses",PERF_TYPE_HW_CACHE,PROFILE_EVENT_CACHE(DTLB,MISS)},
+	{"iTLB-load-misses",PERF_TYPE_HW_CACHE,PROFILE_EVENT_CACHE(ITLB,MISS)},
+	{"page-faults",PERF_TYPE_SOFTWARE,PERF_COUNT_SW_PAGE_FAULTS},
+	{"minor-faults",PERF_TYPE_SOFTWARE,PERF_COUNT_SW_PAGE_FAULTS_MIN},
+	{"major-faults",PERF_TYPE_SOFTWARE,PERF_COUNT_SW_PAGE_FAULTS_MAJ},
+	{"context-switches",PERF_TYPE_SOFTWARE,PERF_COUNT_SW_CONTEXT_SWITCHES},
+	{"cpu-migrations",PERF_TYPE_SOFTWARE,PERF_COUNT_SW_CPU_MIGRATIONS},
+	{NULL,0,0}
+};
+
 #if defined(_PTHREAD_H) && !defined(PROFILE_NO_TLS)
 static __thread PROFILE_THREAD *profile_thread;
 #elif !defined(_PTHREAD_H)
 static PROFILE_THREAD *profile_thread;
 #endif
-static PROFILE_FUNC *profile_root[PROFILE_FUNC_TABLE_SIZE];
-static PROFILE_FUNC *profile_func_alloc;
-static PROFILE_CALLER *profile_caller_alloc;
+static PROFILE_TABLES profile_tables;
+static PROFILE_TASK *profile_tasks;
+static PROFILE_TASK *profile_task_groups;
+static unsigned int profile_task_count;
+static PROFILE_CALLER profile_cache_none;
+static PROFILE_FUNC *profile_func_spare;
+static PROFILE_CALLER *profile_caller_spare;
+static PROFILE_POOL profile_fpool={NULL,sizeof(PROFILE_FUNC),0};
+static PROFILE_POOL profile_cpool={NULL,sizeof(PROFILE_CALLER),0};
+static PROFILE_POOL profile_npool={NULL,sizeof(PROFILE_NODE),0};
+static PROFILE_POOL profile_hpool={NULL,
+	PROFILE_HIST_SIZE*sizeof(unsigned long long),0};
+static PROFILE_POOL profile_spool={NULL,sizeof(PROFILE_SHARD),0};
+static PROFILE_POOL profile_epool={NULL,sizeof(unsigned long long),0};
+static PROFILE_POOL profile_apool={NULL,sizeof(PROFILE_HEAP),0};
+static PROFILE_POOL profile_rpool={NULL,sizeof(PROFILE_ACTIVE),0};
+static PROFILE_NODE profile_node_none;
 static int profile_numthreads;
-static int profile_fpool_limit;
-static int profile_fpool_used;
-static int profile_cpool_limit;
-static int profile_cpool_used;
+static int profile_thread_count;
 static int profile_stack_limit;
+static int profile_stopped;
 static int profile_error;
+static unsigned int profile_epoch;
+static unsigned int profile_reset_epoch;
 static int profile_thread_size;
 static int profile_func_exhausted;
 static int profile_caller_exhausted;
+static int profile_node_exhausted;
+static int profile_cct;
+static int profile_hist;
+static int profile_wall;
+static int profile_sharded;
+static int profile_rseq;
+static unsigned int profile_shards;
+static int profile_events;
+static int profile_event_id[PROFILE_EVENT_MAX];
+static int profile_event_threads;
+static int profile_event_failed;
+static char profile_event_unknown[128];
+static int profile_event_exclude;
+static int profile_heap_on;
+static int profile_filter;
+static int profile_include_count;
+static int profile_exclude_count;
+static PROFILE_RANGE *profile_include;
+static PROFILE_RANGE *profile_exclude;
+static int profile_binary;
 static int profile_stack_exhausted;
+static int profile_memory_error;
 static int profile_time_error;
 static int profile_disabled;
 static int profile_daemon;
 static int profile_pid;
+static int profile_clock;
+static int profile_clock_threads;
+static char *profile_clock_fallback;
+static unsigned long long profile_clock_freq;
+static unsigned long long profile_overhead;
+static unsigned long long profile_heap_overhead;
+static unsigned long long profile_cache_hits;
+static unsigned long long profile_cache_misses;
+static unsigned long long profile_recovered;
 static char *profile_log_file;
+static char *profile_log_template;
+static int profile_log_perproc;
+static int profile_self;
+static int profile_ppid;
 static struct timespec profile_process_time;
+static char profile_log_name[PATH_MAX];
+static PROFILE_SHM *profile_shm;
+static char *profile_shm_name;
+static int profile_shm_fd=-1;
+static unsigned long long profile_control_window;
+static PROFILE_SNAP *profile_snap[3];
+static unsigned long profile_snap_used[3];
+static unsigned long profile_snap_size[3];
 
 #ifdef _PTHREAD_H
 
-static PROFILE_THREAD *profile_thread_table[PROFILE_THREAD_TABLE_SIZE];
+static PROFILE_THREAD **profile_thread_table[PROFILE_THREAD_TABLE_SIZE];
 static pthread_key_t profile_key;
-static int profile_table_next;
+static unsigned int profile_table_next;
+static unsigned long long profile_thread_free;
 static int profile_maxthreads;
+static int profile_private;
 #ifndef PROFILE_NO_ATOMICS
 static int profile_mutex;
-static int profile_mutex2;
+static int profile_shm_mutex;
+static int profile_control_mutex;
 #else
 static pthread_mutex_t profile_mutex=PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t profile_pool_mutex=PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t profile_shm_mutex=PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t profile_control_mutex=PTHREAD_MUTEX_INITIALIZER;
 #endif
+static pthread_t profile_control;
+static int profile_control_active;
+static int profile_control_pipe[2];
+static int profile_control_socket=-1;
+static int profile_control_sig;
+static char *profile_control_path;
+static int profile_interval;
+static int profile_interval_files;
+static int profile_delay;
+static int profile_duration;
 
 #endif
 
-static void __attribute__((no_instrument_function))
+static inline unsigned long long __attribute__((no_instrument_function))
+	__attribute__((always_inline))
 	__attribute__((no_sanitize_address))
 	__attribute__((no_sanitize_thread))
 	__attribute__((no_sanitize_undefined))
 	__attribute__((no_profile_instrument_function))
 	__attribute__((no_stack_limit))
-	__attribute__((optimize("no-stack-protector")))
-	__attribute__((optimize("omit-frame-pointer")))
-	__attribute__((optimize("Os")))
-	profile_stack_unwind(PROFILE_THREAD *tt,int mode)
+	profile_perf_time(struct perf_event_mmap_page *pc)
 {
-	PROFILE_STACK *p=&tt->stack[tt->stack_index];
+#ifdef PROFILE_HAVE_TSC
+	unsigned int seq;
+	unsigned short shift;
+	unsigned int mult;
+	unsigned long long offset;
+	unsigned long long running;
+	unsigned long long cyc;
 
-	for(;tt->stack_index;tt->stack_index--,p--)
+	do
 	{
-#if defined(_PTHREAD_H) && !defined(PROFILE_NO_ATOMICS)
-		__atomic_add_fetch(&p->c->secs,p->used.tv_sec,__ATOMIC_RELAXED);
-		__atomic_add_fetch(&p->c->nsecs,p->used.tv_nsec,
-			__ATOMIC_RELAXED);
-		if(!mode)__atomic_add_fetch(&p->c->unwind,1,__ATOMIC_RELAXED);
+		seq=pc->lock;
+		__atomic_signal_fence(__ATOMIC_SEQ_CST);
+		running=pc->time_running;
+		offset=pc->time_offset;
+		mult=pc->time_mult;
+		shift=pc->time_shift;
+		cyc=__builtin_ia32_rdtsc();
+		__atomic_signal_fence(__ATOMIC_SEQ_CST);
+	} while(__builtin_expect(pc->lock!=seq,0));
 
-		tt->secs+=p->used.tv_sec;
-		tt->nsecs+=p->used.tv_nsec;
-		if(!mode)tt->unwind++;
+	return running+offset+(cyc>>shift)*mult+
+		(((cyc&((1ULL<<shift)-1))*mult)>>shift);
+#else
+	return 0;
+#endif
+}
 
-		if(tt->stack_index==1)
-		{
-#if defined(_PTHREAD_H) && !defined(PROFILE_NO_ATOMICS)
-			unsigned int depth;
+static inline int __attribute__((no_instrument_function))
+	__attribute__((always_inline))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	profile_clock_read(PROFILE_THREAD *tt,unsigned long long *stamp)
+{
+	struct timespec ts;
+#ifdef PROFILE_HAVE_TSC
+	unsigned int aux;
 #endif
 
-			__atomic_add_fetch(&p->e->calls,1,__ATOMIC_RELAXED);
-			__atomic_add_fetch(&p->e->secs,tt->secs,
-				__ATOMIC_RELAXED);
-			__atomic_add_fetch(&p->e->nsecs,tt->nsecs,
-				__ATOMIC_RELAXED);
-			__atomic_add_fetch(&p->e->funcs,tt->funcs,
-				__ATOMIC_RELAXED);
-			__atomic_add_fetch(&p->e->unwind,tt->unwind,
-				__ATOMIC_RELAXED);
-repeat:			depth= __atomic_load_n(&p->e->depth,__ATOMIC_SEQ_CST);
-			if(tt->depth>depth)if(__builtin_expect(
-				!__atomic_compare_exchange_n(&p->e->depth,
-					&depth,tt->depth,1,__ATOMIC_SEQ_CST,
-					__ATOMIC_RELAXED),0))goto repeat;
+	switch(profile_clock)
+	{
+	case PROFILE_CLOCK_PERF:
+		if(__builtin_expect(tt&&tt->clock_page,1))
+		{
+			*stamp=profile_perf_time(tt->clock_page);
+			return 0;
 		}
-#else
-		p->c->secs+=p->used.tv_sec;
-		p->c->nsecs+=p->used.tv_nsec;
-		if(!mode)p->c->unwind++;
+		if(__builtin_expect(profile_gettime(CLOCK_THREAD_CPUTIME_ID,
+			&ts),0))goto fail;
+		break;
 
-		tt->secs+=p->used.tv_sec;
-		tt->nsecs+=p->used.tv_nsec;
-		if(!mode)tt->unwind++;
+#ifdef PROFILE_HAVE_TSC
+	case PROFILE_CLOCK_TSCP:
+		*stamp=__builtin_ia32_rdtscp(&aux);
+		return 0;
 
-		if(tt->stack_index==1)
-		{
-			p->e->calls++;
-			p->e->secs+=tt->secs;
-			p->e->nsecs+=tt->nsecs;
-			p->e->funcs+=tt->funcs;
-			p->e->unwind+=tt->unwind;
-			if(tt->depth>p->e->depth)p->e->depth=tt->depth;
-		}
+	case PROFILE_CLOCK_TSC:
+		*stamp=__builtin_ia32_rdtsc();
+		return 0;
 #endif
+	case PROFILE_CLOCK_MONOTONIC:
+		if(__builtin_expect(clock_gettime(CLOCK_MONOTONIC,&ts),0))
+			goto fail;
+		break;
+
+	default:if(__builtin_expect(profile_gettime(CLOCK_THREAD_CPUTIME_ID,
+			&ts),0))goto fail;
+		break;
 	}
+
+	*stamp=profile_nsecs(ts);
+	return 0;
+
+fail:	*stamp=0;
+	return -1;
 }
 
-#ifdef _PTHREAD_H
+static inline void __attribute__((no_instrument_function))
+	__attribute__((always_inline))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	profile_charge(PROFILE_THREAD *tt,PROFILE_STACK *p,
+		unsigned long long stamp)
+{
+	unsigned long long delta=stamp-tt->start_time;
 
-static void __attribute__((no_instrument_function))
+	p->used+=delta;
+	p->overhead+=delta<profile_overhead?delta:profile_overhead;
+}
+
+static inline int __attribute__((no_instrument_function))
+	__attribute__((always_inline))
 	__attribute__((no_sanitize_address))
 	__attribute__((no_sanitize_thread))
 	__attribute__((no_sanitize_undefined))
 	__attribute__((no_profile_instrument_function))
 	__attribute__((no_stack_limit))
-	__attribute__((optimize("no-stack-protector")))
-	__attribute__((optimize("omit-frame-pointer")))
-	__attribute__((optimize("Os")))
-	profile_thread_cleaner(void *ptr)
+	profile_event_read(PROFILE_THREAD *tt,unsigned long long *v)
 {
-	int mode=0;
-	PROFILE_THREAD **t;
-	PROFILE_THREAD *tt=ptr;
-	struct timespec stamp;
+	int i;
+#ifdef PROFILE_HAVE_TSC
+	unsigned int seq;
+	unsigned int idx;
+	unsigned int width;
+	unsigned long long cnt;
+	struct perf_event_mmap_page *pc;
+#endif
+	unsigned long long bfr[PROFILE_EVENT_MAX+1];
 
-	if(__builtin_expect(!profile_error,1)&&tt->stack_index)
+	if(__builtin_expect(tt->event_fd[0]==-1,0))return -1;
+
+#ifdef PROFILE_HAVE_TSC
+	if(__builtin_expect(tt->event_user,1))
 	{
-		if(tt->stack_index==1)
+		for(i=0;i<profile_events;i++)
 		{
-#ifdef PROFILE_STRICT
-			if(__builtin_expect(
-				profile_gettime(CLOCK_THREAD_CPUTIME_ID,
-					&stamp),0))
+			pc=tt->event_page[i];
+			do
 			{
-				profile_time_error=1;
-				profile_error=1;
-				return;
-			}
-#else
-			profile_gettime(CLOCK_THREAD_CPUTIME_ID,&stamp);
+				seq=pc->lock;
+				__atomic_signal_fence(__ATOMIC_SEQ_CST);
+				idx=pc->index;
+				cnt=pc->offset;
+				if(__builtin_expect(idx!=0,1))
+				{
+					width=64-pc->pmc_width;
+					cnt+=(unsigned long long)((long long)
+						(__builtin_ia32_rdpmc(idx-1)<<
+						width)>>width);
+				}
+				__atomic_signal_fence(__ATOMIC_SEQ_CST);
+			} while(__builtin_expect(pc->lock!=seq,0));
+			v[i]=cnt;
+		}
+		return 0;
+	}
 #endif
-			profile_deltatime(stamp,tt->start_time);
 
-			tt->stack[tt->stack_index].used.tv_nsec+=stamp.tv_nsec;
-			tt->stack[tt->stack_index].used.tv_sec+=stamp.tv_sec;
-			mode=1;
-		}
+	if(__builtin_expect(read(tt->event_fd[0],bfr,(profile_events+1)*
+		sizeof(unsigned long long))!=(profile_events+1)*
+		sizeof(unsigned long long),0))return -1;
+	for(i=0;i<profile_events;i++)v[i]=bfr[i+1];
+	return 0;
+}
 
-#ifdef PROFILE_NO_ATOMICS
-		lock(profile_mutex);
-#endif
-		profile_stack_unwind(tt,mode);
-#ifdef PROFILE_NO_ATOMICS
-		unlock(profile_mutex);
-#endif
+static inline void __attribute__((no_instrument_function))
+	__attribute__((always_inline))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	profile_event_charge(PROFILE_THREAD *tt,PROFILE_CALLER *c)
+{
+	int i;
+	unsigned long long d;
+	unsigned long long v[PROFILE_EVENT_MAX];
 
-		for(t=&profile_thread_table[tt->table_index];*t;t=&(*t)->next)
-			if(*t==tt)
-		{
-			*t=tt->next;
-			break;
-		}
+	if(__builtin_expect(profile_event_read(tt,v),0))return;
 
-		free(tt);
-#ifndef PROFILE_NO_TLS
-		profile_thread=NULL;
+#if defined(_PTHREAD_H) && defined(PROFILE_NO_ATOMICS)
+	if(c&&!profile_private)lock(profile_mutex);
+#endif
+	for(i=0;i<profile_events;i++)
+	{
+		d=v[i]-tt->event_last[i];
+		tt->event_last[i]=v[i];
+		if(!c)continue;
+#if defined(_PTHREAD_H) && !defined(PROFILE_NO_ATOMICS)
+		if(!profile_private)
+			__atomic_add_fetch(&c->events[i],d,__ATOMIC_RELAXED);
+		else
 #endif
+		c->events[i]+=d;
 	}
-#ifndef PROFILE_NO_ATOMICS
-	__atomic_sub_fetch(&profile_numthreads,1,__ATOMIC_SEQ_CST);
-#else
-	lock(profile_mutex);
-	profile_numthreads--;
-	unlock(profile_mutex);
+#if defined(_PTHREAD_H) && defined(PROFILE_NO_ATOMICS)
+	if(c&&!profile_private)unlock(profile_mutex);
 #endif
 }
 
-#endif
-
-void __attribute__ ((constructor)) __attribute__((no_instrument_function))
+static inline void __attribute__((no_instrument_function))
+	__attribute__((always_inline))
 	__attribute__((no_sanitize_address))
 	__attribute__((no_sanitize_thread))
 	__attribute__((no_sanitize_undefined))
 	__attribute__((no_profile_instrument_function))
 	__attribute__((no_stack_limit))
-	__attribute__((optimize("no-stack-protector")))
-	__attribute__((optimize("omit-frame-pointer")))
-	__attribute__((optimize("Os")))
-	__attribute__((cold)) profile_init(void)
+	profile_heap_charge(PROFILE_STACK *p,int locked)
 {
-	char *p;
+	PROFILE_HEAP *h=p->c->heap;
 
-	if(getenv("PROFILE_DISABLE"))
+	if(!(p->allocs|p->frees))return;
+
+#if defined(_PTHREAD_H) && defined(PROFILE_NO_ATOMICS)
+	if(!locked&&!profile_private)lock(profile_mutex);
+#endif
+#if defined(_PTHREAD_H) && !defined(PROFILE_NO_ATOMICS)
+	if(!profile_private)
 	{
-		profile_disabled=1;
-		goto err1;
+		__atomic_add_fetch(&h->allocs,p->allocs,__ATOMIC_RELAXED);
+		__atomic_add_fetch(&h->frees,p->frees,__ATOMIC_RELAXED);
+		__atomic_add_fetch(&h->bytes,p->abytes,__ATOMIC_RELAXED);
+		__atomic_add_fetch(&h->time,p->atime,__ATOMIC_RELAXED);
 	}
+	else
+#endif
+	{
+		h->allocs+=p->allocs;
+		h->frees+=p->frees;
+		h->bytes+=p->abytes;
+		h->time+=p->atime;
+	}
+#if defined(_PTHREAD_H) && defined(PROFILE_NO_ATOMICS)
+	if(!locked&&!profile_private)unlock(profile_mutex);
+#endif
+	p->allocs=0;
+	p->frees=0;
+	p->abytes=0;
+	p->atime=0;
+}
 
-	if(getenv("PROFILE_DAEMON"))profile_daemon=1;
-
-	if(!(p=getenv("PROFILE_FUNC_POOL")))profile_fpool_limit=1000;
-	else if((profile_fpool_limit=atoi(p))<=0)profile_fpool_limit=1000;
-
-	if(!(p=getenv("PROFILE_CALLER_POOL")))profile_cpool_limit=5000;
-	else if((profile_cpool_limit=atoi(p))<=0)profile_cpool_limit=5000;
-
-	if(!(p=getenv("PROFILE_STACK_SIZE")))profile_stack_limit=100;
-	else if((profile_stack_limit=atoi(p))<=0)profile_stack_limit=100;
-	profile_thread_size=++profile_stack_limit*sizeof(PROFILE_STACK)+
-		sizeof(PROFILE_THREAD);
+static inline unsigned long long __attribute__((no_instrument_function))
+	__attribute__((always_inline))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	profile_wall_read(void)
+{
+	struct timespec ts;
 
-	if(!(profile_log_file=getenv("PROFILE_LOG_FILE")))
-		profile_log_file="instrumentation.out";
+	if(__builtin_expect(clock_gettime(CLOCK_MONOTONIC,&ts),0))return 0;
+	return profile_nsecs(ts);
+}
 
-	if(__builtin_expect(!(profile_func_alloc=
-		malloc(profile_fpool_limit*sizeof(PROFILE_FUNC))),0))
-	{
-		profile_func_exhausted=1;
-		goto err1;
-	}
+static inline PROFILE_SHARD *__attribute__((no_instrument_function))
+	__attribute__((always_inline))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	profile_shard(PROFILE_CALLER *c)
+{
+	unsigned int cpu;
+
+#ifdef PROFILE_HAVE_RSEQ
+	if(__builtin_expect(profile_rseq,1))
+		cpu=((volatile struct rseq *)((char *)__builtin_thread_pointer()+
+			__rseq_offset))->cpu_id;
+	else
+#endif
+	cpu=sched_getcpu();
+	return &c->shard[cpu&(profile_shards-1)];
+}
 
-	memset(profile_func_alloc,0,profile_fpool_limit*sizeof(PROFILE_FUNC));
+static inline int __attribute__((no_instrument_function))
+	__attribute__((always_inline))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	profile_range_find(PROFILE_RANGE *r,int n,void *func)
+{
+	int l=0;
+	int m;
 
-	if(__builtin_expect(!(profile_caller_alloc=
-		malloc(profile_cpool_limit*sizeof(PROFILE_CALLER))),0))
+	while(l<n)
 	{
-		profile_caller_exhausted=1;
-		goto err2;
+		m=(l+n)>>1;
+		if((unsigned long)func<r[m].start)n=m;
+		else if((unsigned long)func>=r[m].end)l=m+1;
+		else return 1;
 	}
+	return 0;
+}
 
-	memset(profile_caller_alloc,0,
-		profile_cpool_limit*sizeof(PROFILE_CALLER));
+static inline int __attribute__((no_instrument_function))
+	__attribute__((always_inline))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	profile_filtered(void *func)
+{
+	if((profile_filter&1)&&
+		!profile_range_find(profile_include,profile_include_count,func))
+			return 1;
+	if((profile_filter&2)&&
+		profile_range_find(profile_exclude,profile_exclude_count,func))
+			return 1;
+	return 0;
+}
 
+static inline void __attribute__((no_instrument_function))
+	__attribute__((always_inline))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	profile_wall_add(PROFILE_CALLER *c,unsigned long long wall)
+{
 #ifdef _PTHREAD_H
-	if(__builtin_expect(pthread_key_create(&profile_key,
-		profile_thread_cleaner),0))goto err3;
-#endif
-
-	if(!profile_pid)profile_pid=getpid();
-
-	if(__builtin_expect(clock_gettime(CLOCK_MONOTONIC,
-		&profile_process_time),0))
+	if(profile_private)c->wall+=wall;
+	else
 	{
-		profile_time_error=1;
-#ifdef _PTHREAD_H
-err3:
+#ifndef PROFILE_NO_ATOMICS
+		if(profile_sharded)__atomic_add_fetch(&profile_shard(c)->wall,
+			wall,__ATOMIC_RELAXED);
+		else __atomic_add_fetch(&c->wall,wall,__ATOMIC_RELAXED);
+#else
+		lock(profile_mutex);
+		c->wall+=wall;
+		unlock(profile_mutex);
 #endif
-		free(profile_caller_alloc);
-		profile_caller_alloc=NULL;
-err2:		free(profile_func_alloc);
-		profile_func_alloc=NULL;
-err1:		profile_error=1;
 	}
+#else
+	c->wall+=wall;
+#endif
 }
 
-static void __attribute__((no_instrument_function)) __attribute__((cold))
+static inline unsigned long __attribute__((no_instrument_function))
+	__attribute__((always_inline))
 	__attribute__((no_sanitize_address))
 	__attribute__((no_sanitize_thread))
 	__attribute__((no_sanitize_undefined))
 	__attribute__((no_profile_instrument_function))
 	__attribute__((no_stack_limit))
-	__attribute__((optimize("no-stack-protector")))
-	__attribute__((optimize("omit-frame-pointer")))
-	__attribute__((optimize("Os")))
-	profile_caller_walk(PROFILE_CALLER *f,void *func,FILE *fp)
+	profile_hash(void *func,void *caller)
 {
-	if(f->left)profile_caller_walk(f->left,func,fp);
-	if(f->right)profile_caller_walk(f->right,func,fp);
-	fprintf(fp,"TRACE: %p %p %llu %llu %llu %u\n",func,f->caller,f->calls,
-		f->secs*1000000000ULL+f->nsecs,f->calling,f->unwind);
+	unsigned long long h;
+
+	h=((unsigned long)func)*0x9e3779b97f4a7c15ULL;
+	h^=((unsigned long)caller)*0xc2b2ae3d27d4eb4fULL;
+	h^=h>>29;
+	h^=h>>32;
+	return ((unsigned long)h)|1;
 }
 
-static void __attribute__((no_instrument_function)) __attribute__((cold))
+static inline void __attribute__((no_instrument_function))
+	__attribute__((always_inline))
 	__attribute__((no_sanitize_address))
 	__attribute__((no_sanitize_thread))
 	__attribute__((no_sanitize_undefined))
 	__attribute__((no_profile_instrument_function))
 	__attribute__((no_stack_limit))
-	__attribute__((optimize("no-stack-protector")))
-	__attribute__((optimize("omit-frame-pointer")))
-	__attribute__((optimize("Os")))
-	profile_func_walk(PROFILE_FUNC *f,FILE *fp)
+	profile_hist_add(unsigned long long *h,unsigned long long v,int shared)
 {
-	int i;
+	int e;
+	unsigned int i;
+	unsigned long long max;
+
+	if(v<(1<<PROFILE_HIST_BITS))i=v;
+	else
+	{
+		e=63-__builtin_clzll(v);
+		i=((e-PROFILE_HIST_BITS+1)<<PROFILE_HIST_BITS)|
+			((v>>(e-PROFILE_HIST_BITS))&
+			((1<<PROFILE_HIST_BITS)-1));
+	}
 
-	if(f->left)profile_func_walk(f->left,fp);
-	if(f->right)profile_func_walk(f->right,fp);
-	for(i=0;i<PROFILE_CALLER_TABLE_SIZE;i++)if(f->caller[i])
-		profile_caller_walk(f->caller[i],f->func,fp);
-	if(f->calls)fprintf(fp,"THREAD: %p %llu %llu %llu %u %u\n",f->func,
-		f->calls,f->secs*1000000000ULL+f->nsecs,f->funcs,
-		f->unwind,f->depth);
+#if defined(_PTHREAD_H) && !defined(PROFILE_NO_ATOMICS)
+	if(shared)
+	{
+		__atomic_add_fetch(&h[i],1,__ATOMIC_RELAXED);
+repeat:		max=__atomic_load_n(&h[PROFILE_HIST_MAX],__ATOMIC_RELAXED);
+		if(v>max)if(__builtin_expect(!__atomic_compare_exchange_n(
+			&h[PROFILE_HIST_MAX],&max,v,1,__ATOMIC_RELAXED,
+			__ATOMIC_RELAXED),0))goto repeat;
+		return;
+	}
+#endif
+	h[i]++;
+	max=h[PROFILE_HIST_MAX];
+	if(v>max)h[PROFILE_HIST_MAX]=v;
 }
 
+#ifdef _PTHREAD_H
+
 static void __attribute__((no_instrument_function)) __attribute__((cold))
 	__attribute__((no_sanitize_address))
 	__attribute__((no_sanitize_thread))
@@ -560,46 +1436,24 @@ static void __attribute__((no_instrument_function)) __attribute__((cold))
 	__attribute__((optimize("no-stack-protector")))
 	__attribute__((optimize("omit-frame-pointer")))
 	__attribute__((optimize("Os")))
-	profile_dump_maps(char *bfr,FILE *out)
+	profile_hist_merge(unsigned long long *dst,unsigned long long *src)
 {
-	FILE *fp;
-	char *range;
-	char *start;
-	char *end;
-	char *mode;
-	char *unused1;
-	char *unused2;
-	char *unused3;
-	char *target;
-	char *mem;
+	int i;
 
-	snprintf(bfr,PATH_MAX,"/proc/%d/maps",getpid());
-	if(__builtin_expect(!(fp=fopen(bfr,"re")),0))return;
-	while(fgets(bfr,PATH_MAX,fp))
+	if(!dst||!src)return;
+	for(i=0;i<PROFILE_HIST_MAX;i++)
 	{
-		range=strtok_r(bfr," \t\r\n",&mem);
-		mode=strtok_r(NULL," \t\r\n,",&mem);
-		unused1=strtok_r(NULL," \t\r\n,",&mem);
-		unused2=strtok_r(NULL," \t\r\n,",&mem);
-		unused3=strtok_r(NULL," \t\r\n,",&mem);
-		target=strtok_r(NULL," \t\r\n,",&mem);
-		if(__builtin_expect(!range,0)||__builtin_expect(!mode,0)||
-			__builtin_expect(!unused1,0)||
-			__builtin_expect(!unused2,0)||
-			__builtin_expect(!unused3,0)||
-			__builtin_expect(!target,0))continue;
-		if(strcmp(mode,"r-xp")||*target!='/')continue;
-		start=strtok_r(range,"-",&mem);
-		end=strtok_r(NULL,"\n",&mem);
-		if(__builtin_expect(!start,0)||__builtin_expect(!end,0)||
-			__builtin_expect(!*start,0)||
-			__builtin_expect(!*end,0))continue;
-		fprintf(out,"MAP: 0x%s 0x%s %s\n",start,end,target);
+		dst[i]+=src[i];
+		src[i]=0;
 	}
-	fclose(fp);
+	if(src[i]>dst[i])dst[i]=src[i];
+	src[i]=0;
 }
 
-static void __attribute__((no_instrument_function)) __attribute__((cold))
+#endif
+
+static PROFILE_CHUNK *__attribute__((no_instrument_function))
+	__attribute__((cold))
 	__attribute__((no_sanitize_address))
 	__attribute__((no_sanitize_thread))
 	__attribute__((no_sanitize_undefined))
@@ -608,23 +1462,42 @@ static void __attribute__((no_instrument_function)) __attribute__((cold))
 	__attribute__((optimize("no-stack-protector")))
 	__attribute__((optimize("omit-frame-pointer")))
 	__attribute__((optimize("Os")))
-	profile_dump_cmd(char *bfr,FILE *out)
+	profile_shm_chunk(PROFILE_POOL *p,unsigned long size)
 {
-	FILE *fp;
+	int n;
+	unsigned long long len;
+	PROFILE_CHUNK *c=NULL;
 
-	snprintf(bfr,PATH_MAX,"/proc/%d/cmdline",getpid());
-	if(__builtin_expect(!(fp=fopen(bfr,"re")),0))return;
-	if(__builtin_expect(!fgets(bfr,PATH_MAX,fp),0))
+	len=sysconf(_SC_PAGESIZE)-1;
+	len=(sizeof(PROFILE_CHUNK)+size*p->elsize+len)&~len;
+
+#ifdef _PTHREAD_H
+	lock(profile_shm_mutex);
+#endif
+	if(__builtin_expect((n=profile_shm->chunks)==PROFILE_SHM_CHUNKS,0)||
+		__builtin_expect(ftruncate(profile_shm_fd,
+		profile_shm->filesize+len),0))goto out;
+	if(__builtin_expect((c=mmap(NULL,len,PROT_READ|PROT_WRITE,MAP_SHARED,
+		profile_shm_fd,profile_shm->filesize))==MAP_FAILED,0))
 	{
-		fclose(fp);
-		return;
+		c=NULL;
+		goto out;
 	}
-	fclose(fp);
-	if(__builtin_expect(realpath(bfr,bfr+PATH_MAX)!=NULL,1))
-		fprintf(out,"CMD: %s\n",bfr+PATH_MAX);
+	c->size=size;
+	profile_shm->chunk[n].offset=profile_shm->filesize;
+	profile_shm->chunk[n].size=len;
+	profile_shm->chunk[n].pool=(p==&profile_cpool);
+	profile_shm->filesize+=len;
+	__atomic_store_n(&profile_shm->chunks,n+1,__ATOMIC_RELEASE);
+out:
+#ifdef _PTHREAD_H
+	unlock(profile_shm_mutex);
+#endif
+	return c;
 }
 
-void __attribute__ ((destructor)) __attribute__((no_instrument_function))
+static PROFILE_CHUNK *__attribute__((no_instrument_function))
+	__attribute__((cold))
 	__attribute__((no_sanitize_address))
 	__attribute__((no_sanitize_thread))
 	__attribute__((no_sanitize_undefined))
@@ -633,129 +1506,86 @@ void __attribute__ ((destructor)) __attribute__((no_instrument_function))
 	__attribute__((optimize("no-stack-protector")))
 	__attribute__((optimize("omit-frame-pointer")))
 	__attribute__((optimize("Os")))
-	__attribute__((cold)) profile_fini(void)
+	profile_chunk_new(PROFILE_POOL *p,unsigned long size)
 {
-	int i;
-#if defined(_PTHREAD_H) && defined(PROFILE_NO_TLS)
-	PROFILE_THREAD *tt=pthread_getspecific(profile_key);
-#else
-	PROFILE_THREAD *tt=profile_thread;
-#endif
-	FILE *fp;
-	char *data=NULL;
-	struct timespec stamp;
-	struct timespec cpu;
-	struct rusage r;
-
-	if(__builtin_expect(profile_disabled,0))return;
+	PROFILE_CHUNK *c;
 
-	if(__builtin_expect(profile_gettime(CLOCK_PROCESS_CPUTIME_ID,&cpu),0))
-		goto timeerr;
-
-	if(__builtin_expect(clock_gettime(CLOCK_MONOTONIC,&stamp),0))
-		goto timeerr;
+	if(p->shared)return profile_shm_chunk(p,size);
 
-	if(__builtin_expect(getrusage(RUSAGE_SELF,&r),0))
-	{
-timeerr:	profile_time_error=1;
-		goto fail;
-	}
+	if(__builtin_expect((c=mmap(NULL,sizeof(PROFILE_CHUNK)+size*p->elsize,
+		PROT_READ|PROT_WRITE,MAP_PRIVATE|MAP_ANONYMOUS,-1,0))==
+		MAP_FAILED,0))return NULL;
+	c->size=size;
+	return c;
+}
 
-#ifdef _PTHREAD_H
-	if(__builtin_expect(!profile_error,1))
-		for(i=0;i<PROFILE_THREAD_TABLE_SIZE;i++)
-			while(profile_thread_table[i])
-	{
-		tt=profile_thread_table[i];
-		profile_thread_table[i]=tt->next;
+static void *__attribute__((no_instrument_function))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_pool_get(PROFILE_POOL *p)
+{
+	PROFILE_CHUNK *c;
+	PROFILE_CHUNK *n;
+	unsigned long i;
 
-		profile_stack_unwind(tt,0);
-		free(tt);
-	}
+#if defined(_PTHREAD_H) && !defined(PROFILE_NO_ATOMICS)
+repeat:	c=__atomic_load_n(&p->chunk,__ATOMIC_ACQUIRE);
+	if(__builtin_expect((i=__atomic_fetch_add(&c->used,1,__ATOMIC_RELAXED))<
+		c->size,1))return c->data+i*p->elsize;
+	if(__builtin_expect(!(n=profile_chunk_new(p,c->size<<1)),0))
+		return NULL;
+	n->next=c;
+	if(!__atomic_compare_exchange_n(&p->chunk,&c,n,0,__ATOMIC_ACQ_REL,
+		__ATOMIC_ACQUIRE))
+			munmap(n,sizeof(PROFILE_CHUNK)+n->size*p->elsize);
+	goto repeat;
 #else
-	if(__builtin_expect(!profile_error,1)&&tt)
-	{
-		profile_stack_unwind(tt,0);
-		free(tt);
-	}
-#endif
+	void *e=NULL;
 
-	if(__builtin_expect(!profile_error,1))
-	{
 #ifdef _PTHREAD_H
-		pthread_setspecific(profile_key,NULL);
-		pthread_key_delete(profile_key);
+	lock(profile_pool_mutex);
 #endif
-
-		profile_deltatime(stamp,profile_process_time);
-
-		if(!(data=malloc(2*PATH_MAX)))
-		{
-fail:			profile_error=1;
-		}
-	}
-
-	if(profile_pid==getpid())
+	c=p->chunk;
+	if(__builtin_expect(c->used==c->size,0))
 	{
-		if(profile_daemon)goto out;
+		if(__builtin_expect(!(n=profile_chunk_new(p,c->size<<1)),0))
+			goto out;
+		n->next=c;
+		p->chunk=c=n;
 	}
-	else if(!profile_daemon)goto out;
-
-	if(__builtin_expect((fp=fopen(profile_log_file,"we"))!=NULL,1))
-	{
-		if(__builtin_expect(!profile_error,1))
-		{
-			profile_dump_cmd(data,fp);
-			fprintf(fp,"INFO: runtime %llu\n",profile_nsecs(stamp));
-			fprintf(fp,"INFO: cpu-usage %llu\n",profile_nsecs(cpu));
-			fprintf(fp,"INFO: maxrss %lu\n",r.ru_maxrss);
-			fprintf(fp,"INFO: f-pool-use %d\n",profile_fpool_used);
-			fprintf(fp,"INFO: f-pool-size %d\n",
-				profile_fpool_limit);
-			fprintf(fp,"INFO: f-pool-mem %zd\n",
-				sizeof(PROFILE_FUNC)*profile_fpool_limit);
-			fprintf(fp,"INFO: c-pool-use %d\n",profile_cpool_used);
-			fprintf(fp,"INFO: c-pool-size %d\n",
-				profile_cpool_limit);
-			fprintf(fp,"INFO: c-pool-mem %zd\n",
-				sizeof(PROFILE_CALLER)*profile_cpool_limit);
-			fprintf(fp,"INFO: stack-size %d\n",
-				profile_stack_limit-1);
-			fprintf(fp,"INFO: thread-mem %d\n",profile_thread_size);
+	i=c->used++;
+	e=c->data+i*p->elsize;
+out:
 #ifdef _PTHREAD_H
-			fprintf(fp,"INFO: max-threads %d\n",profile_maxthreads);
-#else
-			fprintf(fp,"INFO: max-threads %d\n",1);
+	unlock(profile_pool_mutex);
 #endif
-			profile_dump_maps(data,fp);
-			for(i=0;i<PROFILE_FUNC_TABLE_SIZE;i++)
-				if(profile_root[i])
-					profile_func_walk(profile_root[i],fp);
-		}
-		else if(!profile_func_exhausted&&!profile_caller_exhausted&&
-		    !profile_stack_exhausted&&!profile_time_error)
-			fprintf(fp,"ERROR: internal or resource problem\n");
-
-		if(__builtin_expect(profile_func_exhausted,0))
-		    fprintf(fp,"ERROR: func pool exhausted\n");
-		if(__builtin_expect(profile_caller_exhausted,0))
-		    fprintf(fp,"ERROR: caller pool exhausted\n");
-		if(__builtin_expect(profile_stack_exhausted,0))
-		    fprintf(fp,"ERROR: time stack exhausted\n");
-		if(__builtin_expect(profile_time_error,0))
-		    fprintf(fp,"ERROR: time access failure\n");
-
-		fclose(fp);
-	}
+	return e;
+#endif
+}
 
-out:	if(__builtin_expect(data!=NULL,1))free(data);
-	if(__builtin_expect(profile_func_alloc!=NULL,1))
-		free(profile_func_alloc);
-	if(__builtin_expect(profile_caller_alloc!=NULL,1))
-		free(profile_caller_alloc);
+static int __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_pool_init(PROFILE_POOL *p)
+{
+	if(__builtin_expect(!(p->chunk=profile_chunk_new(p,p->size)),0))
+		return -1;
+	return 0;
 }
 
-void __attribute__((no_instrument_function)) __attribute__((hot))
+static void __attribute__((no_instrument_function)) __attribute__((cold))
 	__attribute__((no_sanitize_address))
 	__attribute__((no_sanitize_thread))
 	__attribute__((no_sanitize_undefined))
@@ -764,59 +1594,4646 @@ void __attribute__((no_instrument_function)) __attribute__((hot))
 	__attribute__((optimize("no-stack-protector")))
 	__attribute__((optimize("omit-frame-pointer")))
 	__attribute__((optimize("Os")))
-	__cyg_profile_func_enter(void *func,void *caller)
+	profile_pool_free(PROFILE_POOL *p)
 {
-	PROFILE_FUNC **e;
-	PROFILE_CALLER **c;
-	PROFILE_STACK *p;
-#if defined(_PTHREAD_H) && defined(PROFILE_NO_TLS)
-	PROFILE_THREAD *tt=pthread_getspecific(profile_key);
-#else
-	PROFILE_THREAD *tt=profile_thread;
-#endif
-#if defined(_PTHREAD_H) && !defined(PROFILE_NO_ATOMICS)
-	register union
-	{
-		PROFILE_FUNC *e;
-		PROFILE_CALLER *c;
-	} m;
-#endif
-	struct timespec stamp;
+	PROFILE_CHUNK *c;
 
-	if(__builtin_expect(profile_error,0))return;
+	while((c=p->chunk))
+	{
+		p->chunk=c->next;
+		munmap(c,sizeof(PROFILE_CHUNK)+c->size*p->elsize);
+	}
+}
 
-#ifdef PROFILE_STRICT
-	if(__builtin_expect(profile_gettime(CLOCK_THREAD_CPUTIME_ID,&stamp),0))
-		goto timeerr;
+static void __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_pool_usage(PROFILE_POOL *p,unsigned long *used,
+		unsigned long *size)
+{
+	PROFILE_CHUNK *c;
+
+	for(*used=0,*size=0,c=p->chunk;c;c=c->next)
+	{
+		*used+=c->used<c->size?c->used:c->size;
+		*size+=c->size;
+	}
+}
+
+static PROFILE_HASH *__attribute__((no_instrument_function))
+	__attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_hash_new(unsigned long size)
+{
+	unsigned long n;
+	PROFILE_HASH *h;
+
+	for(n=2;n*PROFILE_HASH_SLOTS<2*size;n<<=1);
+	if(__builtin_expect((h=mmap(NULL,sizeof(PROFILE_HASH)+
+		n*sizeof(PROFILE_BUCKET),PROT_READ|PROT_WRITE,
+		MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE,-1,0))==MAP_FAILED,0))
+			return NULL;
+	h->mask=n-1;
+	h->limit=n*PROFILE_HASH_SLOTS/2;
+	return h;
+}
+
+static int __attribute__((no_instrument_function))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_hash_add(PROFILE_HASH *h)
+{
+	PROFILE_HASH *n;
+
+#if defined(_PTHREAD_H) && !defined(PROFILE_NO_ATOMICS)
+	if(__builtin_expect(__atomic_add_fetch(&h->used,1,__ATOMIC_RELAXED)!=
+		h->limit,1))return 0;
+#else
+	if(__builtin_expect(++h->used!=h->limit,1))return 0;
+#endif
+	if(__builtin_expect(!(n=profile_hash_new((h->mask+1)*
+		PROFILE_HASH_SLOTS)),0))return -1;
+	profile_publish(h->next,n);
+	return 0;
+}
+
+static PROFILE_FUNC *__attribute__((no_instrument_function))
+	__attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_func_new(void)
+{
+	PROFILE_FUNC *e;
+
+	if((e=profile_load(profile_func_spare))&&
+		profile_claim(profile_func_spare,e,(PROFILE_FUNC *)NULL))
+			return e;
+	if(__builtin_expect(!(e=profile_pool_get(&profile_fpool)),0)||
+		(profile_hist&&__builtin_expect(!(e->hist=
+		profile_pool_get(&profile_hpool)),0)))
+	{
+		profile_func_exhausted=1;
+		profile_error=1;
+		return NULL;
+	}
+	return e;
+}
+
+static PROFILE_CALLER *__attribute__((no_instrument_function))
+	__attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_caller_new(void)
+{
+	PROFILE_CALLER *c;
+
+	if((c=profile_load(profile_caller_spare))&&
+		profile_claim(profile_caller_spare,c,(PROFILE_CALLER *)NULL))
+			return c;
+	if(__builtin_expect(!(c=profile_pool_get(&profile_cpool)),0)||
+		(profile_sharded&&__builtin_expect(!(c->shard=
+		profile_pool_get(&profile_spool)),0))||(profile_events&&
+		__builtin_expect(!(c->events=profile_pool_get(&profile_epool)),
+		0))||(profile_alloc&&__builtin_expect(!(c->heap=
+		profile_pool_get(&profile_apool)),0)))
+	{
+		profile_caller_exhausted=1;
+		profile_error=1;
+		return NULL;
+	}
+	return c;
+}
+
+static inline void *__attribute__((no_instrument_function))
+	__attribute__((always_inline))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	profile_hash_item(PROFILE_BUCKET *b,int i)
+{
+	void *item=profile_load(b->item[i]);
+
+	return item==PROFILE_HASH_SEALED?NULL:item;
+}
+
+static PROFILE_FUNC *__attribute__((no_instrument_function))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_func_lookup(PROFILE_TABLES *t,void *func)
+{
+	int i;
+	unsigned long v;
+	unsigned long tag=profile_hash(func,NULL);
+	unsigned long idx;
+	PROFILE_HASH *h=t->func;
+	PROFILE_HASH *n;
+	PROFILE_BUCKET *b;
+	PROFILE_FUNC *e=NULL;
+	PROFILE_FUNC *f;
+	PROFILE_FUNC *x;
+
+gen:	idx=tag&h->mask;
+	while(1)
+	{
+		b=&h->bucket[idx];
+		for(i=0;i<PROFILE_HASH_SLOTS;i++)
+		{
+			if((v=profile_load(b->tag[i])))
+			{
+				if(v!=tag)continue;
+				if((f=profile_load(b->item[i]))->func==func)
+					goto found;
+				continue;
+			}
+			f=profile_load(b->item[i]);
+again:			if(f==PROFILE_HASH_SEALED)
+			{
+				h=profile_load(h->next);
+				goto gen;
+			}
+			else if(f)
+			{
+				if(f->func==func)goto found;
+				continue;
+			}
+			if((n=profile_load(h->next)))
+			{
+				if(!profile_claim(b->item[i],f,
+					(PROFILE_FUNC *)PROFILE_HASH_SEALED))
+						goto again;
+				h=n;
+				goto gen;
+			}
+			if(!e)
+			{
+				if(__builtin_expect(!(e=profile_func_new()),0))
+					return NULL;
+				e->func=func;
+			}
+			if(!profile_claim(b->item[i],f,e))goto again;
+			profile_publish(b->tag[i],tag);
+			if(__builtin_expect(profile_hash_add(h),0))
+			{
+				profile_func_exhausted=1;
+				profile_error=1;
+				return NULL;
+			}
+			return e;
+		}
+		idx=(idx+1)&h->mask;
+	}
+
+found:	if(__builtin_expect(e!=NULL,0))
+	{
+		x=NULL;
+		(void)profile_claim(profile_func_spare,x,e);
+	}
+	return f;
+}
+
+static inline PROFILE_CALLER *__attribute__((no_instrument_function))
+	__attribute__((always_inline))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	profile_caller_lookup(PROFILE_TABLES *t,void *func,void *caller)
+{
+	int i;
+	unsigned long v;
+	unsigned long tag=profile_hash(func,caller);
+	unsigned long idx;
+	PROFILE_HASH *h=t->caller;
+	PROFILE_HASH *n;
+	PROFILE_BUCKET *b;
+	PROFILE_CALLER *c=NULL;
+	PROFILE_CALLER *d;
+	PROFILE_CALLER *x;
+	PROFILE_FUNC *e;
+
+gen:	idx=tag&h->mask;
+	while(1)
+	{
+		b=&h->bucket[idx];
+		for(i=0;i<PROFILE_HASH_SLOTS;i++)
+		{
+			if(__builtin_expect((v=profile_load(b->tag[i]))==tag,1))
+			{
+				d=profile_load(b->item[i]);
+				if(__builtin_expect(d->func==func,1)&&
+					__builtin_expect(d->caller==caller,1))
+						goto found;
+				continue;
+			}
+			else if(v)continue;
+			d=profile_load(b->item[i]);
+again:			if(d==PROFILE_HASH_SEALED)
+			{
+				h=profile_load(h->next);
+				goto gen;
+			}
+			else if(d)
+			{
+				if(d->func==func&&d->caller==caller)goto found;
+				continue;
+			}
+			if((n=profile_load(h->next)))
+			{
+				if(!profile_claim(b->item[i],d,
+					(PROFILE_CALLER *)PROFILE_HASH_SEALED))
+						goto again;
+				h=n;
+				goto gen;
+			}
+			if(!c)
+			{
+				if(__builtin_expect(!(e=
+					profile_func_lookup(t,func)),0)||
+					__builtin_expect(!(c=
+					profile_caller_new()),0))return NULL;
+				c->e=e;
+				c->func=func;
+				c->caller=caller;
+			}
+			if(!profile_claim(b->item[i],d,c))goto again;
+			profile_publish(b->tag[i],tag);
+			if(__builtin_expect(profile_hash_add(h),0))
+			{
+				profile_caller_exhausted=1;
+				profile_error=1;
+				return NULL;
+			}
+			return c;
+		}
+		idx=(idx+1)&h->mask;
+	}
+
+found:	if(__builtin_expect(c!=NULL,0))
+	{
+		x=NULL;
+		(void)profile_claim(profile_caller_spare,x,c);
+	}
+	return d;
+}
+
+static inline PROFILE_CALLER *__attribute__((no_instrument_function))
+	__attribute__((always_inline))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	profile_cache_lookup(PROFILE_THREAD *tt,PROFILE_TABLES *t,void *func,
+		void *caller)
+{
+	PROFILE_CALLER **e;
+	PROFILE_CALLER *c;
+
+	e=&tt->cache[(((unsigned long)caller)^(((unsigned long)func)>>4))&
+		(PROFILE_CACHE_SIZE-1)];
+	c=*e;
+	if(__builtin_expect(c->func==func,1)&&
+		__builtin_expect(c->caller==caller,1))
+	{
+		tt->cache_hits++;
+		return c;
+	}
+	tt->cache_misses++;
+	if(__builtin_expect((c=profile_caller_lookup(t,func,caller))!=NULL,1))
+		*e=c;
+	return c;
+}
+
+static void __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_cache_clear(PROFILE_THREAD *tt)
+{
+	int i;
+
+	for(i=0;i<PROFILE_CACHE_SIZE;i++)tt->cache[i]=&profile_cache_none;
+	tt->cache_hits=0;
+	tt->cache_misses=0;
+}
+
+static PROFILE_NODE *__attribute__((no_instrument_function))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_node_new(PROFILE_THREAD *tt,PROFILE_NODE *parent,void *func,
+		void *caller)
+{
+	PROFILE_NODE *n;
+
+	if(__builtin_expect(!(n=profile_pool_get(&profile_npool)),0)||
+		(profile_events&&__builtin_expect(!(n->c.events=
+		profile_pool_get(&profile_epool)),0))||
+		(profile_alloc&&__builtin_expect(!(n->c.heap=
+		profile_pool_get(&profile_apool)),0)))
+	{
+		profile_node_exhausted=1;
+		profile_error=1;
+		return NULL;
+	}
+	if(parent)
+	{
+#ifdef _PTHREAD_H
+		if(__builtin_expect(!(n->c.e=profile_func_lookup(&tt->tables,
+			func)),0))return NULL;
+#else
+		if(__builtin_expect(!(n->c.e=profile_func_lookup(
+			&profile_tables,func)),0))return NULL;
+#endif
+		n->id=++tt->node_count;
+		n->next=tt->nodes;
+		tt->nodes=n;
+	}
+	n->c.func=func;
+	n->c.caller=caller;
+	n->parent=parent;
+	n->last=&profile_node_none;
+	return n;
+}
+
+static PROFILE_CALLER *__attribute__((no_instrument_function))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_node_find(PROFILE_THREAD *tt,PROFILE_NODE *parent,void *func,
+		void *caller)
+{
+	unsigned long i;
+	unsigned long j;
+	unsigned long m;
+	PROFILE_NODE *n;
+	PROFILE_NODE **t;
+
+	if(parent->child)
+		for(i=profile_hash(func,caller)&parent->mask;
+			(n=parent->child[i]);i=(i+1)&parent->mask)
+				if(n->c.func==func&&n->c.caller==caller)goto out;
+
+	if((parent->used+1)*2>parent->mask+1)
+	{
+		m=parent->child?(parent->mask<<1)|1:3;
+		if(__builtin_expect(!(t=calloc(m+1,sizeof(PROFILE_NODE *))),0))
+		{
+			profile_node_exhausted=1;
+			profile_error=1;
+			return NULL;
+		}
+		if(parent->child)
+		{
+			for(i=0;i<=parent->mask;i++)if((n=parent->child[i]))
+			{
+				for(j=profile_hash(n->c.func,n->c.caller)&m;
+					t[j];j=(j+1)&m);
+				t[j]=n;
+			}
+			free(parent->child);
+		}
+		parent->mask=m;
+		parent->child=t;
+	}
+
+	if(__builtin_expect(!(n=profile_node_new(tt,parent,func,caller)),0))
+		return NULL;
+	for(i=profile_hash(func,caller)&parent->mask;parent->child[i];
+		i=(i+1)&parent->mask);
+	parent->child[i]=n;
+	parent->used++;
+
+out:	parent->last=n;
+	return &n->c;
+}
+
+static inline PROFILE_CALLER *__attribute__((no_instrument_function))
+	__attribute__((always_inline))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	profile_node_lookup(PROFILE_THREAD *tt,PROFILE_NODE *parent,void *func,
+		void *caller)
+{
+	PROFILE_NODE *n=parent->last;
+
+	if(__builtin_expect(n->c.func==func,1)&&
+		__builtin_expect(n->c.caller==caller,1))return &n->c;
+	return profile_node_find(tt,parent,func,caller);
+}
+
+static void __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_node_fold(PROFILE_THREAD *tt)
+{
+	int i;
+	PROFILE_NODE *n;
+	PROFILE_CALLER *c;
+
+	for(n=tt->nodes;n;n=n->next)
+	{
+#ifdef _PTHREAD_H
+		if(__builtin_expect(!(c=profile_caller_lookup(&tt->tables,
+			n->c.func,n->c.caller)),0))return;
+#else
+		if(__builtin_expect(!(c=profile_caller_lookup(&profile_tables,
+			n->c.func,n->c.caller)),0))return;
+#endif
+		c->calls+=n->c.calls;
+		c->time+=n->c.time;
+		c->calling+=n->c.calling;
+		c->unwind+=n->c.unwind;
+		c->overhead+=n->c.overhead;
+		c->incl+=n->c.incl;
+		c->incl_overhead+=n->c.incl_overhead;
+		c->incl_trans+=n->c.incl_trans;
+		c->wall+=n->c.wall;
+		for(i=0;i<profile_events;i++)c->events[i]+=n->c.events[i];
+		if(profile_alloc)
+		{
+			c->heap->allocs+=n->c.heap->allocs;
+			c->heap->frees+=n->c.heap->frees;
+			c->heap->bytes+=n->c.heap->bytes;
+			c->heap->time+=n->c.heap->time;
+		}
+	}
+}
+
+static void __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_nodes_free(PROFILE_NODE *root,PROFILE_NODE *nodes)
+{
+	if(root)free(root->child);
+	for(;nodes;nodes=nodes->next)free(nodes->child);
+}
+
+static PROFILE_ACTIVE *__attribute__((no_instrument_function))
+	__attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_active_new(PROFILE_THREAD *tt,void *key)
+{
+	unsigned int i;
+	unsigned int m;
+	PROFILE_ACTIVE *a;
+	PROFILE_ACTIVE **t;
+
+	if(tt->active_used>tt->active_mask)
+	{
+		m=(tt->active_mask<<1)|1;
+		if(__builtin_expect(!(t=calloc(m+1,sizeof(PROFILE_ACTIVE *))),
+			0))goto fail;
+		for(i=0;i<=tt->active_mask;i++)while((a=tt->active[i]))
+		{
+			tt->active[i]=a->next;
+			a->next=t[((unsigned long)a->key>>6)&m];
+			t[((unsigned long)a->key>>6)&m]=a;
+		}
+		free(tt->active);
+		tt->active=t;
+		tt->active_mask=m;
+	}
+	if((a=tt->active_free))tt->active_free=a->next;
+	else if(__builtin_expect(!(a=profile_pool_get(&profile_rpool)),0))
+		goto fail;
+	a->key=key;
+	a->count=0;
+	a->next=tt->active[((unsigned long)key>>6)&tt->active_mask];
+	tt->active[((unsigned long)key>>6)&tt->active_mask]=a;
+	tt->active_used++;
+	return a;
+
+fail:	profile_memory_error=1;
+	profile_error=1;
+	return NULL;
+}
+
+static inline PROFILE_ACTIVE *__attribute__((no_instrument_function))
+	__attribute__((always_inline))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	profile_active_get(PROFILE_THREAD *tt,void *key)
+{
+	PROFILE_ACTIVE *a;
+
+	for(a=tt->active[((unsigned long)key>>6)&tt->active_mask];a;a=a->next)
+		if(__builtin_expect(a->key==key,1))return a;
+	return profile_active_new(tt,key);
+}
+
+static int __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_active_alloc(PROFILE_THREAD *tt)
+{
+	tt->active_mask=63;
+	tt->active_used=0;
+	tt->active_free=NULL;
+	if(__builtin_expect(!(tt->active=calloc(tt->active_mask+1,
+		sizeof(PROFILE_ACTIVE *))),0))return -1;
+	return 0;
+}
+
+static void __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_active_clear(PROFILE_THREAD *tt)
+{
+	unsigned int i;
+	PROFILE_ACTIVE *a;
+
+	for(i=0;i<=tt->active_mask;i++)while((a=tt->active[i]))
+	{
+		tt->active[i]=a->next;
+		a->next=tt->active_free;
+		tt->active_free=a;
+	}
+	tt->active_used=0;
+}
+
+static void __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_active_free(PROFILE_THREAD *tt)
+{
+	profile_active_clear(tt);
+	free(tt->active);
+}
+
+static void __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_tables_free(PROFILE_TABLES *t)
+{
+	PROFILE_HASH *h;
+
+	while((h=t->func))
+	{
+		t->func=h->next;
+		munmap(h,sizeof(PROFILE_HASH)+(h->mask+1)*sizeof(PROFILE_BUCKET));
+	}
+	while((h=t->caller))
+	{
+		t->caller=h->next;
+		munmap(h,sizeof(PROFILE_HASH)+(h->mask+1)*sizeof(PROFILE_BUCKET));
+	}
+}
+
+static int __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_tables_alloc(PROFILE_TABLES *t)
+{
+	t->caller=NULL;
+	if(__builtin_expect(!(t->func=profile_hash_new(profile_fpool.size)),0)||
+		__builtin_expect(!(t->caller=profile_hash_new(
+		profile_cpool.size)),0))
+	{
+		profile_tables_free(t);
+		return -1;
+	}
+	return 0;
+}
+
+static void __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_caller_clear(PROFILE_CALLER *c)
+{
+	int i;
+
+	c->calls=0;
+	c->time=0;
+	c->calling=0;
+	c->unwind=0;
+	c->overhead=0;
+	c->incl=0;
+	c->incl_overhead=0;
+	c->incl_trans=0;
+	c->wall=0;
+	for(i=0;i<profile_events;i++)c->events[i]=0;
+	if(profile_alloc)memset(c->heap,0,sizeof(PROFILE_HEAP));
+}
+
+#ifdef _PTHREAD_H
+
+static void __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_func_clear(PROFILE_FUNC *f)
+{
+	f->calls=0;
+	f->funcs=0;
+	f->time=0;
+	f->unwind=0;
+	f->overhead=0;
+	f->depth=0;
+	if(f->hist)memset(f->hist,0,
+		PROFILE_HIST_SIZE*sizeof(unsigned long long));
+}
+
+static void __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_tables_clear(PROFILE_TABLES *t)
+{
+	unsigned long i;
+	int j;
+	PROFILE_HASH *h;
+	PROFILE_FUNC *f;
+	PROFILE_CALLER *c;
+
+	for(h=t->func;h;h=h->next)
+		for(i=0;i<=h->mask;i++)for(j=0;j<PROFILE_HASH_SLOTS;j++)
+			if((f=profile_hash_item(&h->bucket[i],j)))
+				profile_func_clear(f);
+	for(h=t->caller;h;h=h->next)
+		for(i=0;i<=h->mask;i++)for(j=0;j<PROFILE_HASH_SLOTS;j++)
+			if((c=profile_hash_item(&h->bucket[i],j)))
+				profile_caller_clear(c);
+}
+
+#endif
+
+static void __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_thread_reset(PROFILE_THREAD *tt)
+{
+	unsigned int reset=profile_load(profile_reset_epoch);
+	PROFILE_NODE *n;
+
+	if(tt->reset==reset)return;
+	tt->reset=reset;
+#ifdef _PTHREAD_H
+	profile_tables_clear(&tt->tables);
+#endif
+	if(tt->root)profile_caller_clear(&tt->root->c);
+	for(n=tt->nodes;n;n=n->next)profile_caller_clear(&n->c);
+}
+
+static void __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_clock_open(PROFILE_THREAD *tt)
+{
+#if defined(PROFILE_HAVE_TSC) && defined(SYS_perf_event_open)
+	struct perf_event_attr attr;
+#endif
+
+	tt->clock_page=NULL;
+	tt->clock_fd=-1;
+
+#if defined(PROFILE_HAVE_TSC) && defined(SYS_perf_event_open)
+	if(profile_clock!=PROFILE_CLOCK_PERF)return;
+
+	memset(&attr,0,sizeof(attr));
+	attr.size=sizeof(attr);
+	attr.type=PERF_TYPE_SOFTWARE;
+	attr.config=PERF_COUNT_SW_TASK_CLOCK;
+
+	if(__builtin_expect((tt->clock_fd=syscall(SYS_perf_event_open,&attr,0,
+		-1,-1,PERF_FLAG_FD_CLOEXEC))==-1,0))goto fail;
+
+	if(__builtin_expect((tt->clock_page=mmap(NULL,sysconf(_SC_PAGESIZE),
+		PROT_READ,MAP_SHARED,tt->clock_fd,0))==MAP_FAILED,0))
+	{
+		tt->clock_page=NULL;
+		goto fail;
+	}
+
+	if(__builtin_expect(!tt->clock_page->cap_user_time,0))
+	{
+		munmap(tt->clock_page,sysconf(_SC_PAGESIZE));
+		tt->clock_page=NULL;
+		goto fail;
+	}
+
+	return;
+
+fail:	if(tt->clock_fd!=-1)close(tt->clock_fd);
+	tt->clock_fd=-1;
+#ifdef _PTHREAD_H
+#ifndef PROFILE_NO_ATOMICS
+	__atomic_add_fetch(&profile_clock_threads,1,__ATOMIC_RELAXED);
+#else
+	lock(profile_mutex);
+	profile_clock_threads++;
+	unlock(profile_mutex);
+#endif
+#else
+	profile_clock_threads++;
+#endif
+#endif
+}
+
+static void __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_clock_close(PROFILE_THREAD *tt)
+{
+	if(tt->clock_page)munmap(tt->clock_page,sysconf(_SC_PAGESIZE));
+	if(tt->clock_fd!=-1)close(tt->clock_fd);
+	tt->clock_page=NULL;
+	tt->clock_fd=-1;
+}
+
+static void __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_event_close(PROFILE_THREAD *tt)
+{
+	int i;
+
+	for(i=0;i<PROFILE_EVENT_MAX;i++)
+	{
+		if(tt->event_page[i])munmap(tt->event_page[i],
+			sysconf(_SC_PAGESIZE));
+		if(tt->event_fd[i]!=-1)close(tt->event_fd[i]);
+		tt->event_page[i]=NULL;
+		tt->event_fd[i]=-1;
+	}
+	tt->event_user=0;
+}
+
+static void __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_event_open(PROFILE_THREAD *tt)
+{
+	int i;
+	struct perf_event_attr attr;
+
+	for(i=0;i<PROFILE_EVENT_MAX;i++)
+	{
+		tt->event_page[i]=NULL;
+		tt->event_fd[i]=-1;
+	}
+	tt->event_user=0;
+
+	if(!profile_events)return;
+
+#ifdef SYS_perf_event_open
+	for(i=0;i<profile_events;i++)
+	{
+		memset(&attr,0,sizeof(attr));
+		attr.size=sizeof(attr);
+		attr.type=profile_event_list[profile_event_id[i]].type;
+		attr.config=profile_event_list[profile_event_id[i]].config;
+		attr.read_format=PERF_FORMAT_GROUP;
+		attr.exclude_kernel=profile_event_exclude;
+		attr.exclude_hv=profile_event_exclude;
+
+		if(__builtin_expect((tt->event_fd[i]=syscall(
+			SYS_perf_event_open,&attr,0,-1,i?tt->event_fd[0]:-1,
+			PERF_FLAG_FD_CLOEXEC))==-1,0))goto fail;
+	}
+
+	for(tt->event_user=1,i=0;i<profile_events;i++)
+	{
+		if((tt->event_page[i]=mmap(NULL,sysconf(_SC_PAGESIZE),
+			PROT_READ,MAP_SHARED,tt->event_fd[i],0))==MAP_FAILED)
+				tt->event_page[i]=NULL;
+		if(!tt->event_page[i]||!tt->event_page[i]->cap_user_rdpmc)
+			tt->event_user=0;
+	}
+
+	if(__builtin_expect(!profile_event_read(tt,tt->event_last),1))return;
+#endif
+
+fail:	profile_event_close(tt);
+#ifdef _PTHREAD_H
+#ifndef PROFILE_NO_ATOMICS
+	__atomic_add_fetch(&profile_event_threads,1,__ATOMIC_RELAXED);
+#else
+	lock(profile_mutex);
+	profile_event_threads++;
+	unlock(profile_mutex);
+#endif
+#else
+	profile_event_threads++;
+#endif
+}
+
+static void __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_event_init(void)
+{
+	int i;
+	int len=0;
+	char *p;
+	char *q;
+	char *mem;
+	char bfr[256];
+	PROFILE_THREAD tt;
+
+	if(!(p=getenv("PROFILE_EVENTS")))return;
+	snprintf(bfr,sizeof(bfr),"%s",p);
+
+	for(p=strtok_r(bfr,",",&mem);p;p=strtok_r(NULL,",",&mem))
+	{
+		while(*p==' ')p++;
+		if((q=strchr(p,' ')))*q=0;
+		if(!*p)continue;
+		for(i=0;profile_event_list[i].name;i++)
+			if(!strcmp(p,profile_event_list[i].name))break;
+		if(profile_event_list[i].name&&profile_events<PROFILE_EVENT_MAX)
+			profile_event_id[profile_events++]=i;
+		else if(len<sizeof(profile_event_unknown)-1)
+			len+=snprintf(profile_event_unknown+len,
+				sizeof(profile_event_unknown)-len,"%s%s",
+				len?",":"",p);
+	}
+	if(!profile_events)return;
+
+	profile_event_open(&tt);
+	if(tt.event_fd[0]==-1)
+	{
+		profile_event_exclude=1;
+		profile_event_threads=0;
+		profile_event_open(&tt);
+	}
+	if(tt.event_fd[0]==-1)
+	{
+		profile_event_failed=profile_events;
+		profile_events=0;
+	}
+	else profile_epool.elsize=profile_events*sizeof(unsigned long long);
+	profile_event_close(&tt);
+	profile_event_threads=0;
+}
+
+static void __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_event_info(FILE *fp)
+{
+	int i;
+
+	if(profile_events)
+	{
+		fprintf(fp,"INFO: events ");
+		for(i=0;i<profile_events;i++)fprintf(fp,"%s%s",i?",":"",
+			profile_event_list[profile_event_id[i]].name);
+		fprintf(fp,"\n");
+	}
+	if(profile_event_failed||*profile_event_unknown)
+	{
+		fprintf(fp,"INFO: events-unavailable ");
+		for(i=0;i<profile_event_failed;i++)fprintf(fp,"%s%s",i?",":"",
+			profile_event_list[profile_event_id[i]].name);
+		fprintf(fp,"%s%s\n",profile_event_failed&&
+			*profile_event_unknown?",":"",profile_event_unknown);
+	}
+	if(profile_event_threads)fprintf(fp,"INFO: events-fallback-threads %d\n",
+		profile_event_threads);
+}
+
+static void __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_clock_test(void)
+{
+	int i;
+	PROFILE_THREAD tt;
+	unsigned long long c1;
+	unsigned long long c2;
+	struct timespec t1;
+	struct timespec t2;
+	struct timespec delay;
+
+	profile_clock_open(&tt);
+	if(!tt.clock_page)goto fail;
+
+	delay.tv_sec=0;
+	delay.tv_nsec=1000000;
+
+	if(__builtin_expect(profile_gettime(CLOCK_THREAD_CPUTIME_ID,&t1),0))
+		goto fail;
+	c1=profile_perf_time(tt.clock_page);
+	for(i=0;i<3;i++)
+	{
+		nanosleep(&delay,NULL);
+		do
+		{
+			if(__builtin_expect(profile_gettime(
+				CLOCK_THREAD_CPUTIME_ID,&t2),0))goto fail;
+			profile_deltatime(t2,t1);
+		} while(profile_nsecs(t2)<(i+1)*500000ULL);
+	}
+	c2=profile_perf_time(tt.clock_page);
+	if(__builtin_expect(profile_gettime(CLOCK_THREAD_CPUTIME_ID,&t2),0))
+		goto fail;
+	profile_deltatime(t2,t1);
+
+	c2-=c1;
+	c1=profile_nsecs(t2);
+	if(c2<c1-(c1>>3)||c2>c1+(c1>>3))goto fail;
+
+	profile_clock_close(&tt);
+	return;
+
+fail:	profile_clock_close(&tt);
+	profile_clock=PROFILE_CLOCK_THREAD;
+	profile_clock_fallback="task-clock";
+	profile_clock_threads=0;
+}
+
+static void __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_clock_init(void)
+{
+	char *p;
+#ifdef PROFILE_HAVE_TSC
+	int i;
+	unsigned int a;
+	unsigned int b;
+	unsigned int c;
+	unsigned int d;
+	unsigned long long c1;
+	unsigned long long c2;
+	unsigned long long n;
+	unsigned long long f[3];
+	struct timespec t1;
+	struct timespec t2;
+	struct timespec delay;
+#endif
+
+	profile_clock=PROFILE_CLOCK_THREAD;
+	profile_clock_freq=1000000000ULL;
+
+	if(!(p=getenv("PROFILE_CLOCK"))||!strcmp(p,"thread-cpu"))return;
+
+	if(!strcmp(p,"monotonic"))
+	{
+		profile_clock=PROFILE_CLOCK_MONOTONIC;
+		return;
+	}
+
+	if(!strcmp(p,"task-clock"))
+	{
+		profile_clock=PROFILE_CLOCK_PERF;
+		profile_clock_test();
+		return;
+	}
+
+	if(strcmp(p,"tsc"))
+	{
+		profile_clock_fallback=p;
+		return;
+	}
+
+	profile_clock=PROFILE_CLOCK_MONOTONIC;
+	profile_clock_fallback="tsc";
+
+#ifdef PROFILE_HAVE_TSC
+	profile_cpuid(0x80000000,a,b,c,d);
+	if(a<0x80000007)return;
+	profile_cpuid(0x80000007,a,b,c,d);
+	if(!(d&0x100))return;
+	profile_cpuid(0x80000001,a,b,c,d);
+
+	delay.tv_sec=0;
+	delay.tv_nsec=10000000;
+
+	for(i=0;i<3;i++)
+	{
+		if(__builtin_expect(clock_gettime(CLOCK_MONOTONIC,&t1),0))
+			return;
+		c1=__builtin_ia32_rdtsc();
+		nanosleep(&delay,NULL);
+		if(__builtin_expect(clock_gettime(CLOCK_MONOTONIC,&t2),0))
+			return;
+		c2=__builtin_ia32_rdtsc();
+		profile_deltatime(t2,t1);
+		if(!(n=profile_nsecs(t2))||c2<=c1)return;
+		f[i]=(unsigned long long)((c2-c1)*(1000000000.0L/n));
+	}
+
+	if(f[0]>f[1])
+	{
+		n=f[0];
+		f[0]=f[1];
+		f[1]=n;
+	}
+	if(f[2]<f[1])f[1]=f[2]>f[0]?f[2]:f[0];
+
+	profile_clock=(d&0x8000000)?PROFILE_CLOCK_TSCP:PROFILE_CLOCK_TSC;
+	profile_clock_freq=f[1];
+	profile_clock_fallback=NULL;
+#endif
+}
+
+static void __attribute__((no_instrument_function))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_stack_unwind(PROFILE_THREAD *tt,int mode,int level)
+{
+	PROFILE_STACK *p=&tt->stack[tt->stack_index];
+
+	for(;tt->stack_index>level;tt->stack_index--,p--)
+	{
+		if(profile_alloc)profile_heap_charge(p,1);
+#if defined(_PTHREAD_H) && !defined(PROFILE_NO_ATOMICS)
+		__atomic_add_fetch(&p->c->time,p->used,__ATOMIC_RELAXED);
+		__atomic_add_fetch(&p->c->overhead,p->overhead,
+			__ATOMIC_RELAXED);
+		__atomic_add_fetch(&p->c->wall,p->wused,__ATOMIC_RELAXED);
+		if(!mode)__atomic_add_fetch(&p->c->unwind,1,__ATOMIC_RELAXED);
+
+		tt->time+=p->used;
+		tt->overhead+=p->overhead;
+		if(!mode)tt->unwind++;
+
+		if(!--p->active->count)
+		{
+			__atomic_add_fetch(&p->c->incl,tt->time-p->time0,
+				__ATOMIC_RELAXED);
+			__atomic_add_fetch(&p->c->incl_overhead,
+				tt->overhead-p->overhead0,__ATOMIC_RELAXED);
+			__atomic_add_fetch(&p->c->incl_trans,
+				((tt->funcs-p->funcs0)<<1)+1,__ATOMIC_RELAXED);
+		}
+
+		if(tt->stack_index==1)
+		{
+#if defined(_PTHREAD_H) && !defined(PROFILE_NO_ATOMICS)
+			unsigned int depth;
+#endif
+
+			__atomic_add_fetch(&p->e->calls,1,__ATOMIC_RELAXED);
+			__atomic_add_fetch(&p->e->time,tt->time,
+				__ATOMIC_RELAXED);
+			__atomic_add_fetch(&p->e->overhead,tt->overhead,
+				__ATOMIC_RELAXED);
+			__atomic_add_fetch(&p->e->funcs,tt->funcs,
+				__ATOMIC_RELAXED);
+			__atomic_add_fetch(&p->e->unwind,tt->unwind,
+				__ATOMIC_RELAXED);
+repeat:			depth= __atomic_load_n(&p->e->depth,__ATOMIC_SEQ_CST);
+			if(tt->depth>depth)if(__builtin_expect(
+				!__atomic_compare_exchange_n(&p->e->depth,
+					&depth,tt->depth,1,__ATOMIC_SEQ_CST,
+					__ATOMIC_RELAXED),0))goto repeat;
+		}
+#else
+		p->c->time+=p->used;
+		p->c->overhead+=p->overhead;
+		p->c->wall+=p->wused;
+		if(!mode)p->c->unwind++;
+
+		tt->time+=p->used;
+		tt->overhead+=p->overhead;
+		if(!mode)tt->unwind++;
+
+		if(!--p->active->count)
+		{
+			p->c->incl+=tt->time-p->time0;
+			p->c->incl_overhead+=tt->overhead-p->overhead0;
+			p->c->incl_trans+=((tt->funcs-p->funcs0)<<1)+1;
+		}
+
+		if(tt->stack_index==1)
+		{
+			p->e->calls++;
+			p->e->time+=tt->time;
+			p->e->overhead+=tt->overhead;
+			p->e->funcs+=tt->funcs;
+			p->e->unwind+=tt->unwind;
+			if(tt->depth>p->e->depth)p->e->depth=tt->depth;
+		}
+#endif
+
+		if(tt->stack_index==1)
+		{
+			tt->sum_calls++;
+			tt->sum_funcs+=tt->funcs;
+			tt->sum_time+=tt->time;
+			tt->sum_overhead+=tt->overhead;
+			tt->sum_unwind+=tt->unwind;
+		}
+	}
+}
+
+static int __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((noinline))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_stack_recover(PROFILE_THREAD *tt,void *func,void *caller)
+{
+	int i;
+	int j;
+
+	for(i=tt->stack_index-1;i>0;i--)if(tt->stack[i].func==func&&
+		tt->stack[i].c->caller==caller)break;
+	if(i<=0)return -1;
+
+	for(j=tt->stack_index;j>i;j--)if(tt->stack[j].epoch==tt->epoch)break;
+
+#if defined(_PTHREAD_H) && defined(PROFILE_NO_ATOMICS)
+	lock(profile_mutex);
+#endif
+	profile_stack_unwind(tt,j==i?1:0,i);
+#if defined(_PTHREAD_H) && defined(PROFILE_NO_ATOMICS)
+	unlock(profile_mutex);
+#endif
+	if(j!=i)tt->recovered++;
+	return 0;
+}
+
+static int __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_stack_grow(PROFILE_THREAD *tt)
+{
+	PROFILE_STACK *p;
+
+#ifdef PROFILE_ALLOC
+	if(__builtin_expect(!(p=__libc_realloc(tt->stack,
+#else
+	if(__builtin_expect(!(p=realloc(tt->stack,
+#endif
+		2*tt->stack_size*sizeof(PROFILE_STACK))),0))return -1;
+	tt->stack=p;
+	tt->stack_size<<=1;
+	return 0;
+}
+
+static void __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_task_push(PROFILE_TASK **list,PROFILE_TASK *t)
+{
+#if defined(_PTHREAD_H) && !defined(PROFILE_NO_ATOMICS)
+	t->next=__atomic_load_n(list,__ATOMIC_RELAXED);
+	while(!__atomic_compare_exchange_n(list,&t->next,t,1,__ATOMIC_RELEASE,
+		__ATOMIC_RELAXED));
+#else
+	t->next=*list;
+	*list=t;
+#endif
+}
+
+static void __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_task_max(unsigned long long *v,unsigned long long val)
+{
+#if defined(_PTHREAD_H) && !defined(PROFILE_NO_ATOMICS)
+	unsigned long long cur=__atomic_load_n(v,__ATOMIC_RELAXED);
+
+	while(val>cur)if(__atomic_compare_exchange_n(v,&cur,val,1,
+		__ATOMIC_RELAXED,__ATOMIC_RELAXED))break;
+#else
+	if(val>*v)*v=val;
+#endif
+}
+
+static void __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_task_group(PROFILE_THREAD *tt,char *name)
+{
+	int i;
+	int j;
+	PROFILE_TASK *t;
+	PROFILE_TASK *n=NULL;
+	PROFILE_TASK *head;
+	PROFILE_TASK *end=NULL;
+	char pattern[16];
+	unsigned long long time;
+
+	for(i=0,j=0;name[i]&&j<sizeof(pattern)-1;i++)
+	{
+		if(name[i]<'0'||name[i]>'9')pattern[j++]=name[i];
+		else if(!j||pattern[j-1]!='*')pattern[j++]='*';
+	}
+	pattern[j]=0;
+
+#if defined(_PTHREAD_H) && defined(PROFILE_NO_ATOMICS)
+	lock(profile_mutex);
+#endif
+	head=profile_load(profile_task_groups);
+	while(1)
+	{
+		for(t=head;t!=end;t=t->next)if(!strcmp(t->name,pattern))
+		{
+			free(n);
+			goto found;
+		}
+		if(!n)
+		{
+			if(__builtin_expect(!(n=calloc(1,sizeof(PROFILE_TASK))),
+				0))goto out;
+			memcpy(n->name,pattern,sizeof(n->name));
+		}
+		n->next=end=head;
+		if(profile_claim(profile_task_groups,head,n))break;
+	}
+	t=n;
+
+found:	time=tt->sum_time>tt->sum_overhead?tt->sum_time-tt->sum_overhead:0;
+#if defined(_PTHREAD_H) && !defined(PROFILE_NO_ATOMICS)
+	__atomic_add_fetch(&t->threads,1,__ATOMIC_RELAXED);
+	__atomic_add_fetch(&t->calls,tt->sum_calls,__ATOMIC_RELAXED);
+	__atomic_add_fetch(&t->funcs,tt->sum_funcs,__ATOMIC_RELAXED);
+	__atomic_add_fetch(&t->time,tt->sum_time,__ATOMIC_RELAXED);
+	__atomic_add_fetch(&t->overhead,tt->sum_overhead,__ATOMIC_RELAXED);
+	__atomic_add_fetch(&t->unwind,tt->sum_unwind,__ATOMIC_RELAXED);
+	__atomic_add_fetch(&t->lifetime,profile_wall_read()-tt->birth,
+		__ATOMIC_RELAXED);
+#else
+	t->threads++;
+	t->calls+=tt->sum_calls;
+	t->funcs+=tt->sum_funcs;
+	t->time+=tt->sum_time;
+	t->overhead+=tt->sum_overhead;
+	t->unwind+=tt->sum_unwind;
+	t->lifetime+=profile_wall_read()-tt->birth;
+#endif
+	profile_task_max(&t->maxtime,time);
+	profile_task_max(&t->depth,tt->depth>tt->maxdepth?tt->depth:
+		tt->maxdepth);
+	profile_task_max(&t->frames,tt->stack_size-1);
+out:;
+#if defined(_PTHREAD_H) && defined(PROFILE_NO_ATOMICS)
+	unlock(profile_mutex);
+#endif
+}
+
+static void __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_task_save(PROFILE_THREAD *tt)
+{
+	unsigned int n;
+	PROFILE_TASK *t;
+	char name[16];
+
+	if(prctl(PR_GET_NAME,name))memcpy(name,tt->name,sizeof(name));
+	name[sizeof(name)-1]=0;
+
+#if defined(_PTHREAD_H) && !defined(PROFILE_NO_ATOMICS)
+	__atomic_add_fetch(&profile_cache_hits,tt->cache_hits,__ATOMIC_RELAXED);
+	__atomic_add_fetch(&profile_cache_misses,tt->cache_misses,
+		__ATOMIC_RELAXED);
+	__atomic_add_fetch(&profile_recovered,tt->recovered,__ATOMIC_RELAXED);
+	n=__atomic_add_fetch(&profile_task_count,1,__ATOMIC_RELAXED);
+#else
+#ifdef _PTHREAD_H
+	lock(profile_mutex);
+#endif
+	profile_cache_hits+=tt->cache_hits;
+	profile_cache_misses+=tt->cache_misses;
+	profile_recovered+=tt->recovered;
+	n=++profile_task_count;
+#ifdef _PTHREAD_H
+	unlock(profile_mutex);
+#endif
+#endif
+
+	if(n>PROFILE_TASK_LIMIT&&!profile_cct)
+	{
+		profile_task_group(tt,name);
+		return;
+	}
+
+	if(__builtin_expect(!(t=malloc(sizeof(PROFILE_TASK))),0))return;
+	t->root=tt->root;
+	t->nodes=tt->nodes;
+	t->id=tt->id;
+	t->depth=tt->depth>tt->maxdepth?tt->depth:tt->maxdepth;
+	t->frames=tt->stack_size-1;
+	t->tid=tt->tid;
+	t->calls=tt->sum_calls;
+	t->funcs=tt->sum_funcs;
+	t->time=tt->sum_time;
+	t->overhead=tt->sum_overhead;
+	t->unwind=tt->sum_unwind;
+	t->lifetime=profile_wall_read()-tt->birth;
+	t->maxtime=0;
+	t->threads=1;
+	memcpy(t->name,name,sizeof(t->name));
+#if defined(_PTHREAD_H) && defined(PROFILE_NO_ATOMICS)
+	lock(profile_mutex);
+#endif
+	profile_task_push(&profile_tasks,t);
+#if defined(_PTHREAD_H) && defined(PROFILE_NO_ATOMICS)
+	unlock(profile_mutex);
+#endif
+}
+
+#ifdef _PTHREAD_H
+
+static void __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_merge(PROFILE_THREAD *tt)
+{
+	unsigned long i;
+	int j;
+	int k;
+	PROFILE_HASH *h;
+	PROFILE_FUNC *f;
+	PROFILE_FUNC *e;
+	PROFILE_CALLER *d;
+	PROFILE_CALLER *c;
+
+	if(!tt->tables.func)return;
+
+	lock(profile_mutex);
+
+	profile_thread_reset(tt);
+
+	for(h=tt->tables.func;h;h=h->next)
+		for(i=0;i<=h->mask;i++)for(j=0;j<PROFILE_HASH_SLOTS;j++)
+			if((f=profile_hash_item(&h->bucket[i],j)))
+	{
+		if(__builtin_expect(!(e=profile_func_lookup(&profile_tables,
+			f->func)),0))goto out;
+		e->calls+=f->calls;
+		e->funcs+=f->funcs;
+		e->time+=f->time;
+		e->unwind+=f->unwind;
+		e->overhead+=f->overhead;
+		if(f->depth>e->depth)e->depth=f->depth;
+		profile_hist_merge(e->hist,f->hist);
+		profile_func_clear(f);
+	}
+
+	for(h=tt->tables.caller;h;h=h->next)
+		for(i=0;i<=h->mask;i++)for(j=0;j<PROFILE_HASH_SLOTS;j++)
+			if((d=profile_hash_item(&h->bucket[i],j)))
+	{
+		if(__builtin_expect(!(c=profile_caller_lookup(&profile_tables,
+			d->func,d->caller)),0))goto out;
+		c->calls+=d->calls;
+		c->time+=d->time;
+		c->calling+=d->calling;
+		c->unwind+=d->unwind;
+		c->overhead+=d->overhead;
+		c->incl+=d->incl;
+		c->incl_overhead+=d->incl_overhead;
+		c->incl_trans+=d->incl_trans;
+		c->wall+=d->wall;
+		for(k=0;k<profile_events;k++)c->events[k]+=d->events[k];
+		if(profile_alloc)
+		{
+			c->heap->allocs+=d->heap->allocs;
+			c->heap->frees+=d->heap->frees;
+			c->heap->bytes+=d->heap->bytes;
+			c->heap->time+=d->heap->time;
+		}
+		profile_caller_clear(d);
+	}
+
+out:	unlock(profile_mutex);
+}
+
+static PROFILE_THREAD *__attribute__((no_instrument_function))
+	__attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_thread_pop(void)
+{
+	unsigned long long head;
+	PROFILE_THREAD *tt;
+#ifndef PROFILE_NO_ATOMICS
+	unsigned long long next;
+
+	head=__atomic_load_n(&profile_thread_free,__ATOMIC_ACQUIRE);
+	do
+	{
+		if(!(unsigned int)head)return NULL;
+		tt=profile_thread_table[((unsigned int)head-1)/
+			PROFILE_THREAD_BLOCK_SIZE][((unsigned int)head-1)%
+			PROFILE_THREAD_BLOCK_SIZE];
+		next=(((head>>32)+1)<<32)|
+			__atomic_load_n(&tt->free_next,__ATOMIC_RELAXED);
+	} while(__builtin_expect(!__atomic_compare_exchange_n(
+		&profile_thread_free,&head,next,1,__ATOMIC_ACQUIRE,
+		__ATOMIC_ACQUIRE),0));
+#else
+	tt=NULL;
+	lock(profile_mutex);
+	if((head=profile_thread_free))
+	{
+		tt=profile_thread_table[(head-1)/PROFILE_THREAD_BLOCK_SIZE]
+			[(head-1)%PROFILE_THREAD_BLOCK_SIZE];
+		profile_thread_free=tt->free_next;
+	}
+	unlock(profile_mutex);
+#endif
+	return tt;
+}
+
+static void __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_thread_push(PROFILE_THREAD *tt)
+{
+#ifndef PROFILE_NO_ATOMICS
+	unsigned long long head;
+	unsigned long long next;
+
+	head=__atomic_load_n(&profile_thread_free,__ATOMIC_RELAXED);
+	do
+	{
+		__atomic_store_n(&tt->free_next,(unsigned int)head,
+			__ATOMIC_RELAXED);
+		next=(((head>>32)+1)<<32)|(tt->table_index+1);
+	} while(__builtin_expect(!__atomic_compare_exchange_n(
+		&profile_thread_free,&head,next,1,__ATOMIC_RELEASE,
+		__ATOMIC_RELAXED),0));
+#else
+	lock(profile_mutex);
+	tt->free_next=profile_thread_free;
+	profile_thread_free=tt->table_index+1;
+	unlock(profile_mutex);
+#endif
+}
+
+static int __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_thread_register(PROFILE_THREAD *tt)
+{
+	unsigned int i;
+	PROFILE_THREAD **b;
+	PROFILE_THREAD **n=NULL;
+
+#ifndef PROFILE_NO_ATOMICS
+	i=__atomic_fetch_add(&profile_table_next,1,__ATOMIC_RELAXED);
+#else
+	lock(profile_mutex);
+	i=profile_table_next++;
+#endif
+	if(__builtin_expect(i>=PROFILE_THREAD_TABLE_SIZE*
+		PROFILE_THREAD_BLOCK_SIZE,0))goto fail;
+	if(!(b=profile_load(profile_thread_table[i/PROFILE_THREAD_BLOCK_SIZE])))
+	{
+		if(__builtin_expect(!(b=calloc(PROFILE_THREAD_BLOCK_SIZE,
+			sizeof(PROFILE_THREAD *))),0))goto fail;
+		if(!profile_claim(profile_thread_table[i/
+			PROFILE_THREAD_BLOCK_SIZE],n,b))
+		{
+			free(b);
+			b=n;
+		}
+	}
+	tt->table_index=i;
+	profile_publish(b[i%PROFILE_THREAD_BLOCK_SIZE],tt);
+#ifdef PROFILE_NO_ATOMICS
+	unlock(profile_mutex);
+#endif
+	return 0;
+
+fail:
+#ifdef PROFILE_NO_ATOMICS
+	unlock(profile_mutex);
+#endif
+	return -1;
+}
+
+static void __attribute__((no_instrument_function))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_thread_cleaner(void *ptr)
+{
+	int mode=0;
+	PROFILE_THREAD *tt=ptr;
+	unsigned long long stamp;
+
+	if(__builtin_expect(profile_error,0))return;
+
+	if(tt->stack_index)
+	{
+		if(tt->stack_index==1&&!profile_stopped&&
+			tt->epoch==profile_epoch)
+		{
+#ifdef PROFILE_STRICT
+			if(__builtin_expect(profile_clock_read(tt,&stamp),0))
+			{
+				profile_time_error=1;
+				profile_error=1;
+				return;
+			}
+#else
+			profile_clock_read(tt,&stamp);
+#endif
+			profile_charge(tt,&tt->stack[tt->stack_index],stamp);
+			mode=1;
+		}
+
+#ifdef PROFILE_NO_ATOMICS
+		lock(profile_mutex);
+#endif
+		profile_stack_unwind(tt,mode,0);
+#ifdef PROFILE_NO_ATOMICS
+		unlock(profile_mutex);
+#endif
+
+#ifndef PROFILE_NO_ATOMICS
+		__atomic_sub_fetch(&profile_numthreads,1,__ATOMIC_SEQ_CST);
+#else
+		lock(profile_mutex);
+		profile_numthreads--;
+		unlock(profile_mutex);
+#endif
+	}
+
+	if(profile_cct)profile_node_fold(tt);
+	profile_task_save(tt);
+	profile_merge(tt);
+
+	profile_clock_close(tt);
+	profile_event_close(tt);
+	tt->busy=0;
+	profile_thread_push(tt);
+#ifndef PROFILE_NO_TLS
+	profile_thread=NULL;
+#endif
+}
+
+#endif
+
+static PROFILE_THREAD *__attribute__((no_instrument_function))
+	__attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_thread_new(void)
+{
+	PROFILE_THREAD *tt;
+
+#ifdef PROFILE_STRICT
+	if(__builtin_expect(!(tt=malloc(sizeof(PROFILE_THREAD))),0))
+		return NULL;
+	if(__builtin_expect(!(tt->stack=malloc(profile_stack_limit*
+		sizeof(PROFILE_STACK))),0))goto err1;
+#else
+	tt=malloc(sizeof(PROFILE_THREAD));
+	tt->stack=malloc(profile_stack_limit*sizeof(PROFILE_STACK));
+#endif
+	tt->stack_size=profile_stack_limit;
+	if(__builtin_expect(profile_active_alloc(tt),0))goto err2;
+#ifdef _PTHREAD_H
+	tt->tables.func=NULL;
+	tt->tables.caller=NULL;
+	tt->busy=0;
+	if(__builtin_expect(profile_thread_register(tt),0))goto err3;
+#endif
+	return tt;
+
+#ifdef _PTHREAD_H
+err3:	profile_active_free(tt);
+#endif
+err2:	free(tt->stack);
+#ifdef PROFILE_STRICT
+err1:
+#endif
+	free(tt);
+	return NULL;
+}
+
+void __attribute__((no_instrument_function))
+	__cyg_profile_func_enter(void *func,void *caller);
+void __attribute__((no_instrument_function))
+	__cyg_profile_func_exit(void *func,void *caller);
+static void __attribute__((no_instrument_function))
+	profile_shm_open(char *name);
+static void __attribute__((no_instrument_function))
+	profile_shm_info(void);
+#ifdef _PTHREAD_H
+static void __attribute__((no_instrument_function))
+	profile_control_start(char *path,int sig);
+#else
+extern int pthread_atfork(void (*prepare)(void),void (*parent)(void),
+	void (*child)(void));
+#endif
+static void __attribute__((no_instrument_function))
+	profile_fork_init(void);
+
+static void __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_log_expand(void)
+{
+	int len;
+	char *p;
+	char *q=profile_log_name;
+	char *end=profile_log_name+sizeof(profile_log_name)-1;
+
+	for(p=profile_log_template;*p&&q<end;p++)
+	{
+		if(*p!='%')
+		{
+			*q++=*p;
+			continue;
+		}
+		switch(*++p)
+		{
+		case 'p':
+			len=snprintf(q,end-q+1,"%d",profile_self);
+			break;
+		case 't':
+			len=snprintf(q,end-q+1,"%llu",
+				(unsigned long long)time(NULL));
+			break;
+		case '%':
+			len=1;
+			*q='%';
+			break;
+		default:
+			len=1;
+			*q='%';
+			p--;
+			break;
+		}
+		q+=len<end-q?len:end-q;
+	}
+	*q=0;
+	profile_log_file=profile_log_name;
+}
+
+static void __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_heap_calibrate(void)
+{
+	int i;
+	int j;
+	int n=profile_clock_threads;
+	PROFILE_THREAD tt;
+	unsigned long long start;
+	unsigned long long stamp;
+	unsigned long long min=~0ULL;
+
+	profile_clock_open(&tt);
+	for(i=0;i<5;i++)
+	{
+		profile_clock_read(&tt,&start);
+		for(j=0;j<PROFILE_OVERHEAD_LOOPS;j++)
+			profile_clock_read(&tt,&stamp);
+		if(stamp-start<min)min=stamp-start;
+	}
+	profile_clock_close(&tt);
+	profile_clock_threads=n;
+
+	profile_heap_overhead=2*min/PROFILE_OVERHEAD_LOOPS;
+}
+
+static void __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_overhead_init(void)
+{
+	int i;
+	int j;
+	char *p;
+	PROFILE_THREAD *tt;
+	PROFILE_THREAD *self;
+	PROFILE_TABLES tables=profile_tables;
+	PROFILE_FUNC *func_spare=profile_func_spare;
+	PROFILE_CALLER *caller_spare=profile_caller_spare;
+	PROFILE_POOL *pool[7]={&profile_fpool,&profile_cpool,&profile_npool,
+		&profile_hpool,&profile_spool,&profile_epool,&profile_apool};
+	PROFILE_POOL save[7];
+	int count=profile_thread_count;
+	int clock_threads=profile_clock_threads;
+	int event_threads=profile_event_threads;
+#ifdef _PTHREAD_H
+	int maxthreads=profile_maxthreads;
+#endif
+	unsigned long long start;
+	unsigned long long min=~0ULL;
+
+	if((p=getenv("PROFILE_OVERHEAD")))
+	{
+		profile_overhead=strtoull(p,NULL,10);
+		return;
+	}
+
+#if defined(_PTHREAD_H) && defined(PROFILE_NO_TLS)
+	self=pthread_getspecific(profile_key);
+	pthread_setspecific(profile_key,NULL);
+#else
+	self=profile_thread;
+	profile_thread=NULL;
+#ifdef _PTHREAD_H
+	pthread_setspecific(profile_key,NULL);
+#endif
+#endif
+
+	for(i=0;i<7;i++)
+	{
+		save[i]=*pool[i];
+		pool[i]->chunk=NULL;
+		pool[i]->size=2;
+		pool[i]->shared=0;
+	}
+	profile_func_spare=NULL;
+	profile_caller_spare=NULL;
+	profile_tables.func=NULL;
+	profile_tables.caller=NULL;
+	if(__builtin_expect(profile_pool_init(&profile_fpool),0)||
+		__builtin_expect(profile_pool_init(&profile_cpool),0)||
+		(profile_cct&&
+		__builtin_expect(profile_pool_init(&profile_npool),0))||
+		(profile_hist&&
+		__builtin_expect(profile_pool_init(&profile_hpool),0))||
+		(profile_sharded&&
+		__builtin_expect(profile_pool_init(&profile_spool),0))||
+		(profile_events&&
+		__builtin_expect(profile_pool_init(&profile_epool),0))||
+		(profile_alloc&&
+		__builtin_expect(profile_pool_init(&profile_apool),0))||
+		__builtin_expect(profile_tables_alloc(&profile_tables),0))
+	{
+		profile_func_exhausted=1;
+		profile_error=1;
+		goto out;
+	}
+
+	for(i=0;i<5;i++)
+	{
+		__cyg_profile_func_enter(profile_overhead_init,
+			profile_clock_init);
+		if(__builtin_expect(profile_error,0))goto out;
+#if defined(_PTHREAD_H) && defined(PROFILE_NO_TLS)
+		tt=pthread_getspecific(profile_key);
+#else
+		tt=profile_thread;
+#endif
+		start=tt->start_time;
+		for(j=0;j<PROFILE_OVERHEAD_LOOPS;j++)
+		{
+			__cyg_profile_func_enter(profile_clock_init,
+				profile_overhead_init);
+			__cyg_profile_func_exit(profile_clock_init,
+				profile_overhead_init);
+		}
+		if(tt->start_time-start<min)min=tt->start_time-start;
+		__cyg_profile_func_exit(profile_overhead_init,
+			profile_clock_init);
+		if(__builtin_expect(profile_error,0))goto out;
+	}
+
+	profile_overhead=min/(2*PROFILE_OVERHEAD_LOOPS);
+
+out:
+#if defined(_PTHREAD_H) && defined(PROFILE_NO_TLS)
+	tt=pthread_getspecific(profile_key);
+	pthread_setspecific(profile_key,self);
+#else
+	tt=profile_thread;
+	profile_thread=self;
+#ifdef _PTHREAD_H
+	pthread_setspecific(profile_key,self);
+#endif
+#endif
+	if(tt)
+	{
+		profile_nodes_free(tt->root,tt->nodes);
+		profile_clock_close(tt);
+		profile_event_close(tt);
+#ifdef _PTHREAD_H
+		profile_tables_free(&tt->tables);
+		tt->busy=0;
+		profile_thread_push(tt);
+#else
+		profile_active_free(tt);
+		free(tt->stack);
+		free(tt);
+#endif
+	}
+
+	profile_tables_free(&profile_tables);
+	profile_tables=tables;
+	profile_func_spare=func_spare;
+	profile_caller_spare=caller_spare;
+	for(i=0;i<7;i++)
+	{
+		profile_pool_free(pool[i]);
+		*pool[i]=save[i];
+	}
+	profile_thread_count=count;
+	profile_clock_threads=clock_threads;
+	profile_event_threads=event_threads;
+#ifdef _PTHREAD_H
+	profile_maxthreads=maxthreads;
+#endif
+}
+
+
+static int __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_range_add(PROFILE_RANGE **r,int *n,int *size,
+		unsigned long start,unsigned long end)
+{
+	PROFILE_RANGE *x;
+
+	if(*n==*size)
+	{
+		if(__builtin_expect(!(x=realloc(*r,(*size?*size<<1:256)*
+			sizeof(PROFILE_RANGE))),0))return -1;
+		*r=x;
+		*size=*size?*size<<1:256;
+	}
+	(*r)[*n].start=start;
+	(*r)[(*n)++].end=end;
+	return 0;
+}
+
+static int __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_range_sort(const void *p1,const void *p2)
+{
+	const PROFILE_RANGE *r1=p1;
+	const PROFILE_RANGE *r2=p2;
+
+	if(r1->start<r2->start)return -1;
+	if(r1->start>r2->start)return 1;
+	return 0;
+}
+
+static int __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_filter_syms(char *file,unsigned long start,unsigned long end,
+		unsigned long offset,char **obj,char **sym,int npat,
+		PROFILE_RANGE **r,int *n,int *size)
+{
+	int i;
+	int j;
+	int fd;
+	int err=0;
+	unsigned long k;
+	unsigned long bias;
+	unsigned long addr;
+	unsigned char *m;
+	char *str;
+	char *name;
+	struct stat st;
+	ElfW(Ehdr) *eh;
+	ElfW(Phdr) *ph;
+	ElfW(Shdr) *sh;
+	ElfW(Sym) *sm;
+
+	if((name=strrchr(file,'/')))name++;
+	else name=file;
+	if((fd=open(file,O_RDONLY|O_CLOEXEC))==-1)return 0;
+	if(fstat(fd,&st)||st.st_size<sizeof(ElfW(Ehdr)))goto out;
+	if((m=mmap(NULL,st.st_size,PROT_READ,MAP_PRIVATE,fd,0))==MAP_FAILED)
+		goto out;
+
+	eh=(ElfW(Ehdr) *)m;
+	if(memcmp(eh->e_ident,ELFMAG,SELFMAG)||
+		eh->e_ident[EI_CLASS]!=(__ELF_NATIVE_CLASS==64?ELFCLASS64:
+		ELFCLASS32)||eh->e_phentsize!=sizeof(ElfW(Phdr))||
+		eh->e_shentsize!=sizeof(ElfW(Shdr))||
+		eh->e_phoff+eh->e_phnum*sizeof(ElfW(Phdr))>st.st_size||
+		eh->e_shoff+eh->e_shnum*sizeof(ElfW(Shdr))>st.st_size)goto unmap;
+
+	for(ph=(ElfW(Phdr) *)(m+eh->e_phoff),i=0;i<eh->e_phnum;i++,ph++)
+		if(ph->p_type==PT_LOAD&&ph->p_offset<=offset&&
+			offset<ph->p_offset+ph->p_filesz)break;
+	if(i==eh->e_phnum)goto unmap;
+	bias=start-(ph->p_vaddr+offset-ph->p_offset);
+
+	for(sh=(ElfW(Shdr) *)(m+eh->e_shoff),i=0;i<eh->e_shnum;i++)
+	{
+		if((sh[i].sh_type!=SHT_SYMTAB&&sh[i].sh_type!=SHT_DYNSYM)||
+			sh[i].sh_link>=eh->e_shnum||
+			sh[i].sh_offset+sh[i].sh_size>st.st_size||
+			sh[sh[i].sh_link].sh_offset+
+			sh[sh[i].sh_link].sh_size>st.st_size)continue;
+		str=(char *)m+sh[sh[i].sh_link].sh_offset;
+		for(sm=(ElfW(Sym) *)(m+sh[i].sh_offset),k=0;
+			k<sh[i].sh_size/sizeof(ElfW(Sym));k++,sm++)
+		{
+			if(ELF64_ST_TYPE(sm->st_info)!=STT_FUNC||
+				sm->st_shndx==SHN_UNDEF||!sm->st_value||
+				sm->st_name>=sh[sh[i].sh_link].sh_size)continue;
+			addr=bias+sm->st_value;
+			if(addr<start||addr>=end)continue;
+			for(j=0;j<npat;j++)
+			{
+				if(!*sym[j]||(obj[j]&&fnmatch(obj[j],
+					strchr(obj[j],'/')?file:name,0)))continue;
+				if(fnmatch(sym[j],str+sm->st_name,0))continue;
+				if(__builtin_expect(profile_range_add(r,n,size,
+					addr,addr+(sm->st_size?sm->st_size:1)),
+					0))err=-1;
+				break;
+			}
+		}
+	}
+
+unmap:	munmap(m,st.st_size);
+out:	close(fd);
+	return err;
+}
+
+static int __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_filter_load(char *list,PROFILE_RANGE **r,int *total)
+{
+	int i;
+	int j;
+	int n=0;
+	int size=0;
+	int npat=0;
+	int whole;
+	int syms;
+	int err=-1;
+	unsigned long start;
+	unsigned long end;
+	unsigned long offset;
+	char *p;
+	char *mem;
+	char **obj;
+	char **sym;
+	FILE *fp;
+	char *range;
+	char *mode;
+	char *off;
+	char *unused1;
+	char *unused2;
+	char *target;
+	char *name;
+	char bfr[PATH_MAX];
+
+	*r=NULL;
+	*total=0;
+
+	for(i=1,p=list;*p;p++)if(*p==',')i++;
+	if(__builtin_expect(!(list=strdup(list)),0))return -1;
+	if(__builtin_expect(!(obj=malloc(2*i*sizeof(char *))),0))goto err1;
+	sym=obj+i;
+
+	for(p=strtok_r(list,",",&mem);p;p=strtok_r(NULL,",",&mem))
+	{
+		if((sym[npat]=strrchr(p,':')))
+		{
+			*sym[npat]++=0;
+			obj[npat]=p;
+		}
+		else
+		{
+			sym[npat]=p;
+			obj[npat]=NULL;
+		}
+		npat++;
+	}
+
+	if(__builtin_expect(!(fp=fopen("/proc/self/maps","re")),0))goto err2;
+	while(fgets(bfr,sizeof(bfr),fp))
+	{
+		range=strtok_r(bfr," \t\r\n",&mem);
+		mode=strtok_r(NULL," \t\r\n",&mem);
+		off=strtok_r(NULL," \t\r\n",&mem);
+		unused1=strtok_r(NULL," \t\r\n",&mem);
+		unused2=strtok_r(NULL," \t\r\n",&mem);
+		target=strtok_r(NULL,"\r\n",&mem);
+		if(!range||!mode||!off||!unused1||!unused2||!target)continue;
+		while(*target==' ')target++;
+		if(strcmp(mode,"r-xp")||*target!='/')continue;
+		start=strtoul(range,&p,16);
+		if(*p++!='-')continue;
+		end=strtoul(p,NULL,16);
+		offset=strtoul(off,NULL,16);
+		name=strrchr(target,'/')+1;
+
+		for(whole=0,syms=0,j=0;j<npat;j++)
+			if(!obj[j]||!fnmatch(obj[j],strchr(obj[j],'/')?target:name,
+				0))
+		{
+			if(*sym[j])syms=1;
+			else if(obj[j])whole=1;
+		}
+
+		if(whole)
+		{
+			if(__builtin_expect(profile_range_add(r,&n,&size,start,
+				end),0))goto err3;
+		}
+		else if(syms&&__builtin_expect(profile_filter_syms(target,
+			start,end,offset,obj,sym,npat,r,&n,&size),0))goto err3;
+	}
+
+	if(n)
+	{
+		qsort(*r,n,sizeof(PROFILE_RANGE),profile_range_sort);
+		for(i=0,j=1;j<n;j++)
+		{
+			if((*r)[j].start<=(*r)[i].end)
+			{
+				if((*r)[j].end>(*r)[i].end)(*r)[i].end=(*r)[j].end;
+			}
+			else (*r)[++i]=(*r)[j];
+		}
+		n=i+1;
+	}
+	*total=n;
+	err=0;
+
+err3:	fclose(fp);
+err2:	free(obj);
+err1:	free(list);
+	if(err)
+	{
+		free(*r);
+		*r=NULL;
+	}
+	return err;
+}
+
+static void __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_filter_init(void)
+{
+	char *p;
+
+	if((p=getenv("PROFILE_INCLUDE"))&&*p)
+	{
+		if(__builtin_expect(profile_filter_load(p,&profile_include,
+			&profile_include_count),0))goto err;
+		profile_filter|=1;
+	}
+	if((p=getenv("PROFILE_EXCLUDE"))&&*p)
+	{
+		if(__builtin_expect(profile_filter_load(p,&profile_exclude,
+			&profile_exclude_count),0))goto err;
+		profile_filter|=2;
+	}
+	return;
+
+err:	profile_func_exhausted=1;
+	profile_error=1;
+}
+
+void __attribute__ ((constructor)) __attribute__((no_instrument_function))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	__attribute__((cold)) profile_init(void)
+{
+	int i;
+	char *p;
+#ifdef _PTHREAD_H
+	int sig=0;
+	char *path=NULL;
+#endif
+
+	if(getenv("PROFILE_DISABLE"))
+	{
+		profile_disabled=1;
+		goto err1;
+	}
+
+	if(getenv("PROFILE_DAEMON"))profile_daemon=1;
+
+	if((p=getenv("PROFILE_MODE")))
+	{
+#ifdef _PTHREAD_H
+		if(!strcmp(p,"private"))profile_private=1;
+		else if(!strcmp(p,"cct"))profile_private=profile_cct=1;
+#ifndef PROFILE_NO_ATOMICS
+		else if(!strcmp(p,"sharded"))profile_sharded=1;
+#endif
+#else
+		if(!strcmp(p,"cct"))profile_cct=1;
+#endif
+	}
+
+	if(!(p=getenv("PROFILE_FUNC_POOL")))profile_fpool.size=1000;
+	else if((i=atoi(p))<=0)profile_fpool.size=1000;
+	else profile_fpool.size=i;
+
+	if(!(p=getenv("PROFILE_CALLER_POOL")))profile_cpool.size=5000;
+	else if((i=atoi(p))<=0)profile_cpool.size=5000;
+	else profile_cpool.size=i;
+
+	if(!(p=getenv("PROFILE_NODE_POOL")))profile_npool.size=10000;
+	else if((i=atoi(p))<=0)profile_npool.size=10000;
+	else profile_npool.size=i;
+
+	if(getenv("PROFILE_HISTOGRAM"))
+	{
+		profile_hist=1;
+		profile_hpool.size=profile_fpool.size;
+	}
+
+	if(profile_sharded)
+	{
+		if((i=sysconf(_SC_NPROCESSORS_CONF))<1)i=1;
+		for(profile_shards=1;profile_shards<(unsigned int)i;
+			profile_shards<<=1);
+		profile_spool.elsize=profile_shards*sizeof(PROFILE_SHARD);
+		profile_spool.size=profile_cpool.size;
+#ifdef PROFILE_HAVE_RSEQ
+		if(__rseq_size)profile_rseq=1;
+#endif
+	}
+
+	profile_event_init();
+	profile_epool.size=profile_cpool.size;
+	profile_apool.size=profile_cpool.size;
+	profile_rpool.size=profile_fpool.size;
+
+	if(!(p=getenv("PROFILE_STACK_SIZE")))profile_stack_limit=100;
+	else if((profile_stack_limit=atoi(p))<=0)profile_stack_limit=100;
+	profile_thread_size=++profile_stack_limit*sizeof(PROFILE_STACK)+
+		sizeof(PROFILE_THREAD);
+
+	if(!(profile_log_file=getenv("PROFILE_LOG_FILE")))
+		profile_log_file="instrumentation.out";
+	profile_self=getpid();
+	profile_ppid=getppid();
+	if(strchr(profile_log_file,'%'))
+	{
+		profile_log_template=profile_log_file;
+		if(strstr(profile_log_file,"%p"))profile_log_perproc=1;
+		profile_log_expand();
+	}
+
+	if((p=getenv("PROFILE_FORMAT"))&&!strcmp(p,"binary"))profile_binary=1;
+
+#ifdef _PTHREAD_H
+	if((p=getenv("PROFILE_INTERVAL"))&&(i=atoi(p))>0)profile_interval=i;
+	if(!(p=getenv("PROFILE_INTERVAL_FILES")))profile_interval_files=10;
+	else if((profile_interval_files=atoi(p))<=0)profile_interval_files=10;
+	if((p=getenv("PROFILE_START_DELAY"))&&(i=atoi(p))>0)profile_delay=i;
+	if((p=getenv("PROFILE_DURATION"))&&(i=atoi(p))>0)profile_duration=i;
+	if((p=getenv("PROFILE_CONTROL_SIGNAL")))
+	{
+		if(!strncmp(p,"SIG",3))p+=3;
+		if(!strcmp(p,"USR1"))sig=SIGUSR1;
+		else if(!strcmp(p,"USR2"))sig=SIGUSR2;
+		else if(!strcmp(p,"HUP"))sig=SIGHUP;
+		else if(!strcmp(p,"WINCH"))sig=SIGWINCH;
+		else sig=atoi(p);
+	}
+	path=getenv("PROFILE_CONTROL_SOCKET");
+#endif
+
+	if((p=getenv("PROFILE_SHM")))profile_shm_open(p);
+
+	if(__builtin_expect(profile_pool_init(&profile_fpool),0))
+	{
+		profile_func_exhausted=1;
+		goto err1;
+	}
+
+	if(__builtin_expect(profile_pool_init(&profile_cpool),0))
+	{
+		profile_caller_exhausted=1;
+		goto err2;
+	}
+
+	if(profile_cct&&
+		__builtin_expect(profile_pool_init(&profile_npool),0))
+	{
+		profile_node_exhausted=1;
+		goto err3;
+	}
+
+	if(profile_hist&&
+		__builtin_expect(profile_pool_init(&profile_hpool),0))
+	{
+		profile_func_exhausted=1;
+		goto err4;
+	}
+
+	if(profile_sharded&&
+		__builtin_expect(profile_pool_init(&profile_spool),0))
+	{
+		profile_caller_exhausted=1;
+		goto err4;
+	}
+
+	if(profile_events&&
+		__builtin_expect(profile_pool_init(&profile_epool),0))
+	{
+		profile_caller_exhausted=1;
+		goto err4;
+	}
+
+	if(profile_alloc&&
+		__builtin_expect(profile_pool_init(&profile_apool),0))
+	{
+		profile_caller_exhausted=1;
+		goto err4;
+	}
+
+	if(__builtin_expect(profile_pool_init(&profile_rpool),0))
+	{
+		profile_memory_error=1;
+		goto err4;
+	}
+
+	if(__builtin_expect(profile_tables_alloc(&profile_tables),0))
+	{
+		profile_func_exhausted=1;
+		goto err4;
+	}
+
+	profile_clock_init();
+
+	if(getenv("PROFILE_WALLCLOCK")&&(profile_clock==PROFILE_CLOCK_THREAD||
+		profile_clock==PROFILE_CLOCK_PERF))profile_wall=1;
+
+#ifdef _PTHREAD_H
+	if(__builtin_expect(pthread_key_create(&profile_key,
+		profile_thread_cleaner),0))goto err5;
+#endif
+
+	if(!profile_pid)profile_pid=getpid();
+
+	if(__builtin_expect(clock_gettime(CLOCK_MONOTONIC,
+		&profile_process_time),0))
+	{
+		profile_time_error=1;
+#ifdef _PTHREAD_H
+err5:
+#endif
+		profile_tables_free(&profile_tables);
+		profile_func_spare=NULL;
+		profile_caller_spare=NULL;
+err4:		profile_pool_free(&profile_rpool);
+		profile_pool_free(&profile_apool);
+		profile_pool_free(&profile_epool);
+		profile_pool_free(&profile_spool);
+		profile_pool_free(&profile_hpool);
+		profile_pool_free(&profile_npool);
+err3:		profile_pool_free(&profile_cpool);
+err2:		profile_pool_free(&profile_fpool);
+err1:		profile_error=1;
+	}
+	else
+	{
+		profile_overhead_init();
+		if(!profile_error)profile_filter_init();
+		if(profile_shm)profile_shm_info();
+#ifdef _PTHREAD_H
+		if((profile_interval||profile_delay||profile_duration||sig||
+			path)&&!profile_error)
+		{
+			if(profile_delay)profile_stopped=1;
+			profile_control_start(path,sig);
+			if(!profile_control_active)profile_stopped=0;
+		}
+#endif
+		if(!profile_error)profile_fork_init();
+		if(!profile_error&&profile_alloc)
+		{
+			profile_heap_calibrate();
+			profile_heap_on=1;
+		}
+	}
+}
+
+static void __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_shard_fold(PROFILE_TABLES *t)
+{
+#if defined(_PTHREAD_H) && !defined(PROFILE_NO_ATOMICS)
+	unsigned long i;
+	unsigned int k;
+	int j;
+	PROFILE_HASH *h;
+	PROFILE_CALLER *c;
+	PROFILE_SHARD *s;
+	unsigned long long v;
+
+	if(!profile_sharded)return;
+
+	for(h=t->caller;h;h=profile_load(h->next))
+		for(i=0;i<=h->mask;i++)for(j=0;j<PROFILE_HASH_SLOTS;j++)
+			if((c=profile_hash_item(&h->bucket[i],j)))
+				for(k=0,s=c->shard;k<profile_shards;k++,s++)
+	{
+		if((v=__atomic_exchange_n(&s->calls,0,__ATOMIC_RELAXED)))
+			__atomic_add_fetch(&c->calls,v,__ATOMIC_RELAXED);
+		if((v=__atomic_exchange_n(&s->time,0,__ATOMIC_RELAXED)))
+			__atomic_add_fetch(&c->time,v,__ATOMIC_RELAXED);
+		if((v=__atomic_exchange_n(&s->calling,0,__ATOMIC_RELAXED)))
+			__atomic_add_fetch(&c->calling,v,__ATOMIC_RELAXED);
+		if((v=__atomic_exchange_n(&s->overhead,0,__ATOMIC_RELAXED)))
+			__atomic_add_fetch(&c->overhead,v,__ATOMIC_RELAXED);
+		if((v=__atomic_exchange_n(&s->incl,0,__ATOMIC_RELAXED)))
+			__atomic_add_fetch(&c->incl,v,__ATOMIC_RELAXED);
+		if((v=__atomic_exchange_n(&s->incl_overhead,0,
+			__ATOMIC_RELAXED)))__atomic_add_fetch(&c->incl_overhead,
+				v,__ATOMIC_RELAXED);
+		if((v=__atomic_exchange_n(&s->incl_trans,0,__ATOMIC_RELAXED)))
+			__atomic_add_fetch(&c->incl_trans,v,__ATOMIC_RELAXED);
+		if((v=__atomic_exchange_n(&s->wall,0,__ATOMIC_RELAXED)))
+			__atomic_add_fetch(&c->wall,v,__ATOMIC_RELAXED);
+	}
+#endif
+}
+
+static void __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_tables_walk(PROFILE_TABLES *t,FILE *fp)
+{
+	unsigned long i;
+	int j;
+	int k;
+	PROFILE_HASH *h;
+	PROFILE_FUNC *e;
+	PROFILE_CALLER *c;
+
+	if(profile_binary)goto hist;
+
+	for(h=t->caller;h;h=h->next)
+		for(i=0;i<=h->mask;i++)for(j=0;j<PROFILE_HASH_SLOTS;j++)
+			if((c=profile_hash_item(&h->bucket[i],j))&&c->e)
+				fprintf(fp,"TRACE: %p %p %llu %llu %llu %u "
+					"%llu %llu %llu %llu %llu\n",c->func,
+					c->caller,c->calls,c->time,c->calling,
+					c->unwind,c->overhead,c->incl,
+					c->incl_overhead,c->incl_trans,
+					c->wall);
+
+	for(h=t->func;h;h=h->next)
+		for(i=0;i<=h->mask;i++)for(j=0;j<PROFILE_HASH_SLOTS;j++)
+			if((e=profile_hash_item(&h->bucket[i],j))&&e->calls)
+				fprintf(fp,"THREAD: %p %llu %llu %llu %u %u "
+					"%llu\n",e->func,e->calls,e->time,
+					e->funcs,e->unwind,e->depth,
+					e->overhead);
+
+hist:	if(profile_hist)for(h=t->func;h;h=h->next)
+		for(i=0;i<=h->mask;i++)for(j=0;j<PROFILE_HASH_SLOTS;j++)
+			if((e=profile_hash_item(&h->bucket[i],j))&&e->hist)
+	{
+		for(k=0;k<PROFILE_HIST_MAX;k++)if(e->hist[k])
+			fprintf(fp,"HIST: %p %d %llu\n",e->func,k,e->hist[k]);
+		if(e->hist[k])
+			fprintf(fp,"HIST: %p max %llu\n",e->func,e->hist[k]);
+	}
+
+	if(profile_events)for(h=t->caller;h;h=h->next)
+		for(i=0;i<=h->mask;i++)for(j=0;j<PROFILE_HASH_SLOTS;j++)
+			if((c=profile_hash_item(&h->bucket[i],j))&&c->e)
+	{
+		for(k=0;k<profile_events;k++)if(c->events[k])break;
+		if(k==profile_events)continue;
+		fprintf(fp,"EVENT: %p %p",c->func,c->caller);
+		for(k=0;k<profile_events;k++)fprintf(fp," %llu",c->events[k]);
+		fprintf(fp,"\n");
+	}
+
+	if(profile_alloc)for(h=t->caller;h;h=h->next)
+		for(i=0;i<=h->mask;i++)for(j=0;j<PROFILE_HASH_SLOTS;j++)
+			if((c=profile_hash_item(&h->bucket[i],j))&&c->e&&
+				(c->heap->allocs|c->heap->frees))
+		fprintf(fp,"ALLOC: %p %p %llu %llu %llu %llu\n",c->func,
+			c->caller,c->heap->allocs,c->heap->frees,
+			c->heap->bytes,c->heap->time);
+}
+
+static unsigned long long __attribute__((no_instrument_function))
+	__attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_dump_maps(char *bfr,FILE *out,int binary)
+{
+	unsigned long long total=0;
+	PROFILE_BIN_MAP *m=(PROFILE_BIN_MAP *)(bfr+PATH_MAX);
+	FILE *fp;
+	char *range;
+	char *start;
+	char *end;
+	char *mode;
+	char *unused1;
+	char *unused2;
+	char *unused3;
+	char *target;
+	char *mem;
+
+	snprintf(bfr,PATH_MAX,"/proc/%d/maps",getpid());
+	if(__builtin_expect(!(fp=fopen(bfr,"re")),0))return 0;
+	while(fgets(bfr,PATH_MAX,fp))
+	{
+		range=strtok_r(bfr," \t\r\n",&mem);
+		mode=strtok_r(NULL," \t\r\n,",&mem);
+		unused1=strtok_r(NULL," \t\r\n,",&mem);
+		unused2=strtok_r(NULL," \t\r\n,",&mem);
+		unused3=strtok_r(NULL," \t\r\n,",&mem);
+		target=strtok_r(NULL," \t\r\n,",&mem);
+		if(__builtin_expect(!range,0)||__builtin_expect(!mode,0)||
+			__builtin_expect(!unused1,0)||
+			__builtin_expect(!unused2,0)||
+			__builtin_expect(!unused3,0)||
+			__builtin_expect(!target,0))continue;
+		if(strcmp(mode,"r-xp")||*target!='/')continue;
+		start=strtok_r(range,"-",&mem);
+		end=strtok_r(NULL,"\n",&mem);
+		if(__builtin_expect(!start,0)||__builtin_expect(!end,0)||
+			__builtin_expect(!*start,0)||
+			__builtin_expect(!*end,0))continue;
+		if(!binary)
+		{
+			fprintf(out,"MAP: 0x%s 0x%s %s\n",start,end,target);
+			continue;
+		}
+		m->len=strlen(target);
+		m->size=(sizeof(PROFILE_BIN_MAP)+m->len+8)&~7;
+		if(__builtin_expect(m->size>PATH_MAX,0))continue;
+		m->start=strtoull(start,NULL,16);
+		m->end=strtoull(end,NULL,16);
+		memset(m->file+m->len,0,m->size-sizeof(PROFILE_BIN_MAP)-m->len);
+		memcpy(m->file,target,m->len);
+		fwrite(m,m->size,1,out);
+		total++;
+	}
+	fclose(fp);
+	return total;
+}
+
+static int __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_dump_binary(PROFILE_TABLES *t,char *bfr,FILE *fp)
+{
+	unsigned long i;
+	int j;
+	int n;
+	PROFILE_HASH *h;
+	PROFILE_FUNC *e;
+	PROFILE_CALLER *c;
+	PROFILE_BIN_CALLER *bc;
+	PROFILE_BIN_FUNC *bf;
+	PROFILE_BIN_HEADER hdr;
+	long off;
+
+	if(__builtin_expect((off=ftell(fp))==-1,0)||
+		__builtin_expect(fseek(fp,off,SEEK_SET),0))return -1;
+	if(__builtin_expect(!(bc=malloc(PROFILE_BIN_CHUNK)),0))return -1;
+	bf=(PROFILE_BIN_FUNC *)bc;
+
+	memset(&hdr,0,sizeof(hdr));
+	memcpy(hdr.magic,PROFILE_BIN_MAGIC,sizeof(PROFILE_BIN_MAGIC));
+	hdr.version=PROFILE_BIN_VERSION;
+	hdr.size=sizeof(hdr);
+	hdr.callersize=sizeof(PROFILE_BIN_CALLER);
+	hdr.funcsize=sizeof(PROFILE_BIN_FUNC);
+	if(__builtin_expect(fwrite(&hdr,sizeof(hdr),1,fp)!=1,0))goto err;
+
+	hdr.calleroff=sizeof(hdr);
+	for(n=0,h=t->caller;h;h=h->next)
+		for(i=0;i<=h->mask;i++)for(j=0;j<PROFILE_HASH_SLOTS;j++)
+			if((c=profile_hash_item(&h->bucket[i],j))&&c->e)
+	{
+		bc[n].func=(unsigned long)c->func;
+		bc[n].caller=(unsigned long)c->caller;
+		bc[n].calls=c->calls;
+		bc[n].time=c->time;
+		bc[n].calling=c->calling;
+		bc[n].unwind=c->unwind;
+		bc[n].overhead=c->overhead;
+		bc[n].incl=c->incl;
+		bc[n].incl_overhead=c->incl_overhead;
+		bc[n].incl_trans=c->incl_trans;
+		bc[n].wall=c->wall;
+		hdr.callers++;
+		if(++n==PROFILE_BIN_CHUNK/sizeof(PROFILE_BIN_CALLER))
+		{
+			if(__builtin_expect(fwrite(bc,
+				sizeof(PROFILE_BIN_CALLER),n,fp)!=n,0))goto err;
+			n=0;
+		}
+	}
+	if(n&&__builtin_expect(fwrite(bc,sizeof(PROFILE_BIN_CALLER),n,fp)!=n,
+		0))goto err;
+
+	hdr.funcoff=hdr.calleroff+hdr.callers*sizeof(PROFILE_BIN_CALLER);
+	for(n=0,h=t->func;h;h=h->next)
+		for(i=0;i<=h->mask;i++)for(j=0;j<PROFILE_HASH_SLOTS;j++)
+			if((e=profile_hash_item(&h->bucket[i],j))&&e->calls)
+	{
+		bf[n].func=(unsigned long)e->func;
+		bf[n].calls=e->calls;
+		bf[n].time=e->time;
+		bf[n].funcs=e->funcs;
+		bf[n].overhead=e->overhead;
+		bf[n].unwind=e->unwind;
+		bf[n].depth=e->depth;
+		hdr.funcs++;
+		if(++n==PROFILE_BIN_CHUNK/sizeof(PROFILE_BIN_FUNC))
+		{
+			if(__builtin_expect(fwrite(bf,
+				sizeof(PROFILE_BIN_FUNC),n,fp)!=n,0))goto err;
+			n=0;
+		}
+	}
+	if(n&&__builtin_expect(fwrite(bf,sizeof(PROFILE_BIN_FUNC),n,fp)!=n,
+		0))goto err;
+	free(bc);
+	bc=NULL;
+
+	hdr.mapoff=hdr.funcoff+hdr.funcs*sizeof(PROFILE_BIN_FUNC);
+	hdr.maps=profile_dump_maps(bfr,fp,1);
+	if(__builtin_expect(ferror(fp),0))goto err;
+
+	if(__builtin_expect((long)(hdr.textoff=ftell(fp))==-1,0)||
+		__builtin_expect(fseek(fp,off,SEEK_SET),0)||
+		__builtin_expect(fwrite(&hdr,sizeof(hdr),1,fp)!=1,0)||
+		__builtin_expect(fseek(fp,0,SEEK_END),0))goto err;
+	return 0;
+
+err:	free(bc);
+	clearerr(fp);
+	if(!fseek(fp,off,SEEK_SET)&&ftruncate(fileno(fp),off))clearerr(fp);
+	return -1;
+}
+
+static void __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_dump_cmd(char *bfr,FILE *out)
+{
+	FILE *fp;
+
+	snprintf(bfr,PATH_MAX,"/proc/%d/cmdline",getpid());
+	if(__builtin_expect(!(fp=fopen(bfr,"re")),0))return;
+	if(__builtin_expect(!fgets(bfr,PATH_MAX,fp),0))
+	{
+		fclose(fp);
+		return;
+	}
+	fclose(fp);
+	if(__builtin_expect(realpath(bfr,bfr+PATH_MAX)!=NULL,1))
+		fprintf(out,"CMD: %s\n",bfr+PATH_MAX);
+}
+
+static const char *__attribute__((no_instrument_function))
+	__attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_clock_name(void)
+{
+	return profile_clock==PROFILE_CLOCK_PERF?"task-clock":
+		profile_clock>=PROFILE_CLOCK_TSC?"tsc":
+		profile_clock==PROFILE_CLOCK_MONOTONIC?"monotonic":"thread-cpu";
+}
+
+static void __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_shm_open(char *name)
+{
+	long size;
+	char bfr[PATH_MAX];
+
+	if(profile_cct||profile_sharded||!*name||strchr(name,'/'))return;
+#ifdef _PTHREAD_H
+	if(profile_private)return;
+#endif
+
+	size=sysconf(_SC_PAGESIZE)-1;
+	size=(sizeof(PROFILE_SHM)+size)&~size;
+	snprintf(bfr,sizeof(bfr),"/dev/shm/%s",name);
+
+	if(__builtin_expect((profile_shm_fd=open(bfr,
+		O_RDWR|O_CREAT|O_TRUNC|O_CLOEXEC,0600))==-1,0))return;
+	if(__builtin_expect(ftruncate(profile_shm_fd,size),0))goto err;
+	if(__builtin_expect((profile_shm=mmap(NULL,size,PROT_READ|PROT_WRITE,
+		MAP_SHARED,profile_shm_fd,0))==MAP_FAILED,0))
+	{
+		profile_shm=NULL;
+		goto err;
+	}
+
+	profile_shm->version=PROFILE_SHM_VERSION;
+	profile_shm->size=size;
+	profile_shm->pid=getpid();
+	profile_shm->chunkdata=offsetof(PROFILE_CHUNK,data);
+	profile_shm->chunksize=offsetof(PROFILE_CHUNK,size);
+	profile_shm->chunkused=offsetof(PROFILE_CHUNK,used);
+	profile_shm->funcsize=sizeof(PROFILE_FUNC);
+	profile_shm->callersize=sizeof(PROFILE_CALLER);
+	profile_shm->callerfunc=offsetof(PROFILE_CALLER,func);
+	profile_shm->callercaller=offsetof(PROFILE_CALLER,caller);
+	profile_shm->callercalls=offsetof(PROFILE_CALLER,calls);
+	profile_shm->callertime=offsetof(PROFILE_CALLER,time);
+	profile_shm->calleroverhead=offsetof(PROFILE_CALLER,overhead);
+	profile_shm->filesize=size;
+	profile_shm_name=name;
+	profile_fpool.shared=1;
+	profile_cpool.shared=1;
+	return;
+
+err:	close(profile_shm_fd);
+	profile_shm_fd=-1;
+	unlink(bfr);
+}
+
+static void __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_shm_info(void)
+{
+	FILE *fp;
+	char *bfr;
+
+	profile_shm->clockfreq=profile_clock_freq;
+	profile_shm->overhead=profile_overhead;
+	strncpy(profile_shm->clock,profile_clock_name(),
+		sizeof(profile_shm->clock)-1);
+
+	if(__builtin_expect(!(bfr=malloc(2*PATH_MAX)),0))goto out;
+	if(__builtin_expect(!(fp=fmemopen(profile_shm->maps,
+		sizeof(profile_shm->maps)-1,"w")),0))goto err;
+	profile_dump_maps(bfr,fp,0);
+	fclose(fp);
+err:	free(bfr);
+out:	__atomic_thread_fence(__ATOMIC_RELEASE);
+	memcpy(profile_shm->magic,PROFILE_SHM_MAGIC,
+		sizeof(PROFILE_SHM_MAGIC));
+}
+
+static void __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_shm_close(void)
+{
+	char bfr[PATH_MAX];
+
+	if(!profile_shm)return;
+	__atomic_store_n(&profile_shm->done,1,__ATOMIC_RELEASE);
+	if(profile_shm->pid==getpid())
+	{
+		snprintf(bfr,sizeof(bfr),"/dev/shm/%s",profile_shm_name);
+		unlink(bfr);
+	}
+	munmap(profile_shm,profile_shm->size);
+	close(profile_shm_fd);
+	profile_shm=NULL;
+	profile_shm_fd=-1;
+}
+
+#if defined(_PTHREAD_H) && !defined(PROFILE_NO_ATOMICS)
+#define profile_peek(a)		__atomic_load_n(&(a),__ATOMIC_RELAXED)
+#else
+#define profile_peek(a)		(a)
+#endif
+
+static int __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_snap_sort(const void *p1,const void *p2)
+{
+	const PROFILE_SNAP *s1=p1;
+	const PROFILE_SNAP *s2=p2;
+
+	if(s1->item<s2->item)return -1;
+	if(s1->item>s2->item)return 1;
+	return 0;
+}
+
+static PROFILE_SNAP *__attribute__((no_instrument_function))
+	__attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_snap_get(int n)
+{
+	PROFILE_SNAP *s;
+
+	if(profile_snap_used[n]==profile_snap_size[n])
+	{
+		if(__builtin_expect(!(s=realloc(profile_snap[n],
+			(profile_snap_size[n]?profile_snap_size[n]<<1:1024)*
+			sizeof(PROFILE_SNAP))),0))return NULL;
+		profile_snap[n]=s;
+		profile_snap_size[n]=profile_snap_size[n]?
+			profile_snap_size[n]<<1:1024;
+	}
+	return &profile_snap[n][profile_snap_used[n]++];
+}
+
+static void __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_snap_free(void)
+{
+	int i;
+
+	for(i=0;i<3;i++)
+	{
+		free(profile_snap[i]);
+		profile_snap[i]=NULL;
+		profile_snap_used[i]=0;
+		profile_snap_size[i]=0;
+	}
+}
+
+static int __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_snap_take(int n)
+{
+	unsigned long i;
+	int j;
+	int k;
+	int err=-1;
+	PROFILE_HASH *h;
+	PROFILE_FUNC *e;
+	PROFILE_CALLER *c;
+	PROFILE_SNAP *s;
+
+	profile_snap_used[n]=0;
+
+#if defined(_PTHREAD_H) && !defined(PROFILE_NO_ATOMICS)
+	if(profile_private)lock(profile_mutex);
+#elif defined(_PTHREAD_H)
+	lock(profile_mutex);
+#endif
+
+	profile_shard_fold(&profile_tables);
+
+	for(h=profile_tables.caller;h;h=profile_load(h->next))
+		for(i=0;i<=h->mask;i++)for(j=0;j<PROFILE_HASH_SLOTS;j++)
+			if((c=profile_hash_item(&h->bucket[i],j)))
+	{
+		if(__builtin_expect(!(s=profile_snap_get(n)),0))goto out;
+		s->item=c;
+		s->func=c->func;
+		s->caller=c->caller;
+		s->type=PROFILE_SNAP_CALLER;
+		s->v[0]=profile_peek(c->calls);
+		s->v[1]=profile_peek(c->time);
+		s->v[2]=profile_peek(c->calling);
+		s->v[3]=profile_peek(c->unwind);
+		s->v[4]=profile_peek(c->overhead);
+		s->v[5]=profile_peek(c->incl);
+		s->v[6]=profile_peek(c->incl_overhead);
+		s->v[7]=profile_peek(c->incl_trans);
+		s->v[8]=profile_peek(c->wall);
+		for(k=0;k<PROFILE_EVENT_MAX;k++)s->v[PROFILE_SNAP_EVENT+k]=
+			k<profile_events?profile_peek(c->events[k]):0;
+		if(profile_alloc)
+		{
+			s->v[PROFILE_SNAP_HEAP]=profile_peek(c->heap->allocs);
+			s->v[PROFILE_SNAP_HEAP+1]=profile_peek(c->heap->frees);
+			s->v[PROFILE_SNAP_HEAP+2]=profile_peek(c->heap->bytes);
+			s->v[PROFILE_SNAP_HEAP+3]=profile_peek(c->heap->time);
+		}
+		else for(k=0;k<4;k++)s->v[PROFILE_SNAP_HEAP+k]=0;
+	}
+
+	for(h=profile_tables.func;h;h=profile_load(h->next))
+		for(i=0;i<=h->mask;i++)for(j=0;j<PROFILE_HASH_SLOTS;j++)
+			if((e=profile_hash_item(&h->bucket[i],j)))
+	{
+		if(__builtin_expect(!(s=profile_snap_get(n)),0))goto out;
+		s->item=e;
+		s->func=e->func;
+		s->caller=NULL;
+		s->type=PROFILE_SNAP_FUNC;
+		s->v[0]=profile_peek(e->calls);
+		s->v[1]=profile_peek(e->time);
+		s->v[2]=profile_peek(e->funcs);
+		s->v[3]=profile_peek(e->unwind);
+		s->v[4]=profile_peek(e->overhead);
+		s->v[5]=profile_peek(e->depth);
+	}
+
+	err=0;
+
+out:
+#if defined(_PTHREAD_H) && !defined(PROFILE_NO_ATOMICS)
+	if(profile_private)unlock(profile_mutex);
+#elif defined(_PTHREAD_H)
+	unlock(profile_mutex);
+#endif
+	if(!err)qsort(profile_snap[n],profile_snap_used[n],
+		sizeof(PROFILE_SNAP),profile_snap_sort);
+	return err;
+}
+
+static void __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_snap_apply(int n,int b)
+{
+	unsigned long i;
+	unsigned long j;
+	int k;
+	unsigned long long d[PROFILE_SNAP_VALUES];
+	PROFILE_SNAP *s;
+	PROFILE_SNAP *p;
+	PROFILE_FUNC *e;
+	PROFILE_CALLER *c;
+
+#if defined(_PTHREAD_H) && !defined(PROFILE_NO_ATOMICS)
+	if(profile_private)lock(profile_mutex);
+#elif defined(_PTHREAD_H)
+	lock(profile_mutex);
+#endif
+
+	for(i=0,j=0;i<profile_snap_used[n];i++)
+	{
+		s=&profile_snap[n][i];
+		p=NULL;
+		if(b>=0)
+		{
+			while(j<profile_snap_used[b]&&
+				profile_snap[b][j].item<s->item)j++;
+			if(j<profile_snap_used[b]&&
+				profile_snap[b][j].item==s->item)
+				p=&profile_snap[b][j];
+		}
+		for(k=0;k<PROFILE_SNAP_VALUES;k++)d[k]=p?(s->v[k]>p->v[k]?s->v[k]-p->v[k]:0):
+			s->v[k];
+
+#if defined(_PTHREAD_H) && !defined(PROFILE_NO_ATOMICS)
+		if(!profile_private)
+		{
+			if(s->type==PROFILE_SNAP_CALLER)
+			{
+				c=s->item;
+				__atomic_sub_fetch(&c->calls,d[0],
+					__ATOMIC_RELAXED);
+				__atomic_sub_fetch(&c->time,d[1],
+					__ATOMIC_RELAXED);
+				__atomic_sub_fetch(&c->calling,d[2],
+					__ATOMIC_RELAXED);
+				__atomic_sub_fetch(&c->unwind,d[3],
+					__ATOMIC_RELAXED);
+				__atomic_sub_fetch(&c->overhead,d[4],
+					__ATOMIC_RELAXED);
+				__atomic_sub_fetch(&c->incl,d[5],
+					__ATOMIC_RELAXED);
+				__atomic_sub_fetch(&c->incl_overhead,d[6],
+					__ATOMIC_RELAXED);
+				__atomic_sub_fetch(&c->incl_trans,d[7],
+					__ATOMIC_RELAXED);
+				__atomic_sub_fetch(&c->wall,d[8],
+					__ATOMIC_RELAXED);
+				for(k=0;k<profile_events;k++)
+					__atomic_sub_fetch(&c->events[k],
+						d[PROFILE_SNAP_EVENT+k],
+						__ATOMIC_RELAXED);
+				if(profile_alloc)
+				{
+					__atomic_sub_fetch(&c->heap->allocs,
+						d[PROFILE_SNAP_HEAP],
+						__ATOMIC_RELAXED);
+					__atomic_sub_fetch(&c->heap->frees,
+						d[PROFILE_SNAP_HEAP+1],
+						__ATOMIC_RELAXED);
+					__atomic_sub_fetch(&c->heap->bytes,
+						d[PROFILE_SNAP_HEAP+2],
+						__ATOMIC_RELAXED);
+					__atomic_sub_fetch(&c->heap->time,
+						d[PROFILE_SNAP_HEAP+3],
+						__ATOMIC_RELAXED);
+				}
+			}
+			else
+			{
+				e=s->item;
+				__atomic_sub_fetch(&e->calls,d[0],
+					__ATOMIC_RELAXED);
+				__atomic_sub_fetch(&e->time,d[1],
+					__ATOMIC_RELAXED);
+				__atomic_sub_fetch(&e->funcs,d[2],
+					__ATOMIC_RELAXED);
+				__atomic_sub_fetch(&e->unwind,d[3],
+					__ATOMIC_RELAXED);
+				__atomic_sub_fetch(&e->overhead,d[4],
+					__ATOMIC_RELAXED);
+			}
+			continue;
+		}
+#endif
+		if(s->type==PROFILE_SNAP_CALLER)
+		{
+			c=s->item;
+			c->calls-=d[0];
+			c->time-=d[1];
+			c->calling-=d[2];
+			c->unwind-=d[3];
+			c->overhead-=d[4];
+			c->incl-=d[5];
+			c->incl_overhead-=d[6];
+			c->incl_trans-=d[7];
+			c->wall-=d[8];
+			for(k=0;k<profile_events;k++)
+				c->events[k]-=d[PROFILE_SNAP_EVENT+k];
+			if(profile_alloc)
+			{
+				c->heap->allocs-=d[PROFILE_SNAP_HEAP];
+				c->heap->frees-=d[PROFILE_SNAP_HEAP+1];
+				c->heap->bytes-=d[PROFILE_SNAP_HEAP+2];
+				c->heap->time-=d[PROFILE_SNAP_HEAP+3];
+			}
+		}
+		else
+		{
+			e=s->item;
+			e->calls-=d[0];
+			e->time-=d[1];
+			e->funcs-=d[2];
+			e->unwind-=d[3];
+			e->overhead-=d[4];
+		}
+	}
+
+#if defined(_PTHREAD_H) && !defined(PROFILE_NO_ATOMICS)
+	if(profile_private)unlock(profile_mutex);
+#elif defined(_PTHREAD_H)
+	unlock(profile_mutex);
+#endif
+}
+
+static void __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_snap_write(FILE *fp,char *bfr,int n,int b,unsigned long long start,
+		unsigned long long end)
+{
+	unsigned long i;
+	unsigned long j;
+	int k;
+	unsigned long long d[PROFILE_SNAP_VALUES];
+	PROFILE_SNAP *s;
+	PROFILE_SNAP *p;
+
+	profile_dump_cmd(bfr,fp);
+	if(b>=0)fprintf(fp,"INFO: window %llu %llu %llu\n",
+		profile_control_window,start,end);
+	fprintf(fp,"INFO: runtime %llu\n",end-start);
+	fprintf(fp,"INFO: clock %s %llu\n",profile_clock_name(),
+		profile_clock_freq);
+	fprintf(fp,"INFO: overhead %llu\n",profile_overhead);
+	if(profile_wall)fprintf(fp,"INFO: wallclock 1\n");
+	profile_event_info(fp);
+	profile_dump_maps(bfr,fp,0);
+
+	for(i=0,j=0;i<profile_snap_used[n];i++)
+	{
+		s=&profile_snap[n][i];
+		p=NULL;
+		if(b>=0)
+		{
+			while(j<profile_snap_used[b]&&
+				profile_snap[b][j].item<s->item)j++;
+			if(j<profile_snap_used[b]&&
+				profile_snap[b][j].item==s->item)
+				p=&profile_snap[b][j];
+		}
+		for(k=0;k<PROFILE_SNAP_VALUES;k++)d[k]=p?(s->v[k]>p->v[k]?s->v[k]-p->v[k]:0):
+			s->v[k];
+
+		if(s->type==PROFILE_SNAP_CALLER)
+		{
+			if(!d[0]&&!d[1]&&!d[2])continue;
+			fprintf(fp,"TRACE: %p %p %llu %llu %llu %llu %llu %llu "
+				"%llu %llu %llu\n",s->func,s->caller,d[0],
+				d[1],d[2],d[3],d[4],d[5],d[6],d[7],d[8]);
+			if(profile_alloc&&(d[PROFILE_SNAP_HEAP]|
+				d[PROFILE_SNAP_HEAP+1]))fprintf(fp,"ALLOC: %p %p "
+				"%llu %llu %llu %llu\n",s->func,s->caller,
+				d[PROFILE_SNAP_HEAP],d[PROFILE_SNAP_HEAP+1],
+				d[PROFILE_SNAP_HEAP+2],d[PROFILE_SNAP_HEAP+3]);
+			for(k=0;k<profile_events;k++)
+				if(d[PROFILE_SNAP_EVENT+k])break;
+			if(k==profile_events)continue;
+			fprintf(fp,"EVENT: %p %p",s->func,s->caller);
+			for(k=0;k<profile_events;k++)
+				fprintf(fp," %llu",d[PROFILE_SNAP_EVENT+k]);
+			fprintf(fp,"\n");
+		}
+		else
+		{
+			if(!d[0]&&!d[1])continue;
+			fprintf(fp,"THREAD: %p %llu %llu %llu %llu %llu %llu\n",
+				s->func,d[0],d[1],d[2],d[3],s->v[5],d[4]);
+		}
+	}
+}
+
+static unsigned long long __attribute__((no_instrument_function))
+	__attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_control_time(void)
+{
+	struct timespec now;
+
+	if(__builtin_expect(clock_gettime(CLOCK_MONOTONIC,&now),0))return 0;
+	profile_deltatime(now,profile_process_time);
+	return profile_nsecs(now);
+}
+
+static void __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_control_pause(int stop)
+{
+	if(stop)__atomic_store_n(&profile_stopped,1,__ATOMIC_RELEASE);
+	else if(profile_stopped)
+	{
+		__atomic_store_n(&profile_epoch,profile_epoch+1,__ATOMIC_RELAXED);
+		__atomic_store_n(&profile_stopped,0,__ATOMIC_RELEASE);
+	}
+}
+
+static int __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_control_dump(char *path,char *bfr)
+{
+	FILE *fp;
+
+	if(__builtin_expect(profile_snap_take(2),0))return -1;
+	snprintf(bfr,PATH_MAX,"%s.tmp",path);
+	if(__builtin_expect(!(fp=fopen(bfr,"we")),0))return -1;
+	profile_snap_write(fp,bfr,2,-1,0,profile_control_time());
+	if(__builtin_expect(fclose(fp),0))return -1;
+	snprintf(bfr,PATH_MAX,"%s.tmp",path);
+	if(__builtin_expect(rename(bfr,path),0))
+	{
+		unlink(bfr);
+		return -1;
+	}
+	return 0;
+}
+
+static int __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_control_reset(void)
+{
+	unsigned long i;
+	int j;
+	int k;
+	PROFILE_HASH *h;
+	PROFILE_FUNC *e;
+	PROFILE_TASK *t;
+	PROFILE_NODE *n;
+
+#if defined(_PTHREAD_H) && !defined(PROFILE_NO_ATOMICS)
+	__atomic_add_fetch(&profile_reset_epoch,1,__ATOMIC_SEQ_CST);
+#elif defined(_PTHREAD_H)
+	lock(profile_mutex);
+	profile_reset_epoch++;
+	unlock(profile_mutex);
+#else
+	profile_reset_epoch++;
+	if(profile_thread)profile_thread_reset(profile_thread);
+#endif
+	if(__builtin_expect(profile_snap_take(2),0))return -1;
+	profile_snap_apply(2,-1);
+	if(profile_cct)for(t=profile_load(profile_tasks);t;t=t->next)
+	{
+		if(t->root)profile_caller_clear(&t->root->c);
+		for(n=t->nodes;n;n=n->next)profile_caller_clear(&n->c);
+	}
+	if(profile_hist)for(h=profile_tables.func;h;h=profile_load(h->next))
+		for(i=0;i<=h->mask;i++)for(j=0;j<PROFILE_HASH_SLOTS;j++)
+			if((e=profile_hash_item(&h->bucket[i],j))&&e->hist)
+				for(k=0;k<PROFILE_HIST_SIZE;k++)
+#if defined(_PTHREAD_H) && !defined(PROFILE_NO_ATOMICS)
+		__atomic_store_n(&e->hist[k],0,__ATOMIC_RELAXED);
+#else
+		e->hist[k]=0;
+#endif
+	profile_snap_take((profile_control_window&1)^1);
+	return 0;
+}
+
+static int __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_control_cmd(char *cmd,char *bfr)
+{
+	int err=0;
+
+#ifdef _PTHREAD_H
+	lock(profile_control_mutex);
+#endif
+	if(!strcmp(cmd,"dump"))err=profile_control_dump(profile_log_file,bfr);
+	else if(!strcmp(cmd,"reset"))err=profile_control_reset();
+	else if(!strcmp(cmd,"pause"))profile_control_pause(1);
+	else if(!strcmp(cmd,"resume"))profile_control_pause(0);
+	else err=-1;
+#ifdef _PTHREAD_H
+	unlock(profile_control_mutex);
+#endif
+	return err;
+}
+
+void __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_pause(void)
+{
+#if defined(_PTHREAD_H) && defined(PROFILE_NO_TLS)
+	PROFILE_THREAD *tt=pthread_getspecific(profile_key);
+#else
+	PROFILE_THREAD *tt=profile_thread;
+#endif
+	PROFILE_STACK *p;
+	unsigned long long stamp;
+
+	if(__builtin_expect(profile_error,0))return;
+
+	if(tt&&tt->stack_index&&!profile_stopped&&tt->epoch==profile_epoch)
+	{
+		p=&tt->stack[tt->stack_index];
+		if(!profile_clock_read(tt,&stamp))profile_charge(tt,p,stamp);
+		if(profile_wall)p->wused+=profile_wall_read()-tt->wstart;
+		if(profile_events)profile_event_charge(tt,p->c);
+	}
+
+	profile_control_cmd("pause",NULL);
+}
+
+void __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_resume(void)
+{
+#if defined(_PTHREAD_H) && defined(PROFILE_NO_TLS)
+	PROFILE_THREAD *tt=pthread_getspecific(profile_key);
+#else
+	PROFILE_THREAD *tt=profile_thread;
+#endif
+
+	if(__builtin_expect(profile_error,0))return;
+
+	profile_control_cmd("resume",NULL);
+
+	if(tt&&tt->epoch!=profile_epoch)
+	{
+		tt->epoch=profile_epoch;
+		if(__builtin_expect(profile_clock_read(tt,&tt->start_time),0))
+		{
+			profile_time_error=1;
+			profile_error=1;
+			return;
+		}
+		if(profile_wall)tt->wstart=profile_wall_read();
+		if(profile_events)profile_event_charge(tt,NULL);
+	}
+}
+
+int __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_reset(void)
+{
+	if(__builtin_expect(profile_error,0))return -1;
+	return profile_control_cmd("reset",NULL);
+}
+
+int __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_snapshot(const char *path)
+{
+	int err;
+	char *bfr;
+
+	if(__builtin_expect(profile_error,0)||!path||!*path||
+		strlen(path)>=PATH_MAX-4)return -1;
+	if(__builtin_expect(!(bfr=malloc(2*PATH_MAX)),0))return -1;
+#ifdef _PTHREAD_H
+	lock(profile_control_mutex);
+#endif
+	err=profile_control_dump((char *)path,bfr);
+#ifdef _PTHREAD_H
+	unlock(profile_control_mutex);
+#endif
+	free(bfr);
+	return err;
+}
+
+#ifdef _PTHREAD_H
+
+static void __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_window_dump(unsigned long long *start,char *bfr)
+{
+	int n=profile_control_window&1;
+	unsigned long long end=profile_control_time();
+	FILE *fp;
+
+	lock(profile_control_mutex);
+	if(profile_stopped)goto out;
+
+	if(__builtin_expect(profile_snap_take(n),0))goto out;
+
+	snprintf(bfr,PATH_MAX,"%s.%llu",profile_log_file,
+		profile_control_window);
+	if(__builtin_expect((fp=fopen(bfr,"we"))!=NULL,1))
+	{
+		profile_snap_write(fp,bfr,n,n^1,*start,end);
+		fclose(fp);
+	}
+
+	if(profile_control_window>=profile_interval_files)
+	{
+		snprintf(bfr,PATH_MAX,"%s.%llu",profile_log_file,
+			profile_control_window-profile_interval_files);
+		unlink(bfr);
+	}
+	profile_control_window++;
+
+out:	unlock(profile_control_mutex);
+	*start=end;
+}
+
+static void __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_control_accept(char *bfr)
+{
+	int fd;
+	int len;
+	char *cmd;
+	char *mem;
+	struct pollfd p;
+
+	if((fd=accept(profile_control_socket,NULL,NULL))==-1)return;
+	fcntl(fd,F_SETFD,FD_CLOEXEC);
+	p.fd=fd;
+	p.events=POLLIN;
+	if(poll(&p,1,1000)!=1||(len=read(fd,bfr,PATH_MAX-1))<=0)goto out;
+	bfr[len]=0;
+	if(!(cmd=strtok_r(bfr," \t\r\n",&mem)))goto out;
+	if(!profile_control_cmd(cmd,bfr+PATH_MAX))
+		len=write(fd,"ok\n",3);
+	else len=write(fd,"failed\n",7);
+out:	close(fd);
+}
+
+static void __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_control_signal(int sig)
+{
+	int err=errno;
+
+	if(profile_control_active&&write(profile_control_pipe[1],"d",1)){}
+	errno=err;
+}
+
+static void *__attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_control_run(void *unused)
+{
+	int i;
+	int n;
+	int timeout;
+	unsigned long long start=0;
+	unsigned long long next;
+	unsigned long long now;
+	unsigned long long begin=0;
+	unsigned long long end=0;
+	unsigned long long until;
+	char *bfr;
+	char c[16];
+	struct pollfd p[2];
+
+	if(__builtin_expect(!(bfr=malloc(3*PATH_MAX)),0))return NULL;
+
+	p[0].fd=profile_control_pipe[0];
+	p[0].events=POLLIN;
+	p[1].fd=profile_control_socket;
+	p[1].events=POLLIN;
+	n=profile_control_socket!=-1?2:1;
+	now=profile_control_time();
+	next=now+profile_interval*1000000ULL;
+	if(profile_delay)begin=now+profile_delay*1000000ULL;
+	if(profile_duration)end=now+(profile_delay+profile_duration)*1000000ULL;
+
+	while(1)
+	{
+		now=profile_control_time();
+		if(begin&&now>=begin)
+		{
+			profile_control_cmd("resume",NULL);
+			begin=0;
+		}
+		if(end&&now>=end)
+		{
+			profile_control_cmd("pause",NULL);
+			end=0;
+		}
+
+		until=begin?begin:end;
+		if(profile_interval&&(!until||next<until))until=next;
+		if(!until)timeout=-1;
+		else if(now>=until)timeout=0;
+		else timeout=(until-now+999999)/1000000;
+
+		if(!timeout||!poll(p,n,timeout))
+		{
+			if(profile_interval&&profile_control_time()>=next)
+			{
+				profile_window_dump(&start,bfr);
+				next+=profile_interval*1000000ULL;
+			}
+			continue;
+		}
+
+		if(p[0].revents&POLLIN)
+		{
+			if((i=read(p[0].fd,c,sizeof(c)))<=0)continue;
+			if(memchr(c,'q',i))break;
+			profile_control_cmd("dump",bfr);
+		}
+		if(n==2&&(p[1].revents&POLLIN))profile_control_accept(bfr);
+	}
+
+	free(bfr);
+	return NULL;
+}
+
+static void __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_control_start(char *path,int sig)
+{
+	sigset_t set;
+	sigset_t old;
+	struct sockaddr_un a;
+	struct sigaction sa;
+
+	if(__builtin_expect(pipe(profile_control_pipe),0))return;
+	fcntl(profile_control_pipe[0],F_SETFD,FD_CLOEXEC);
+	fcntl(profile_control_pipe[1],F_SETFD,FD_CLOEXEC);
+	fcntl(profile_control_pipe[0],F_SETFL,O_NONBLOCK);
+	fcntl(profile_control_pipe[1],F_SETFL,O_NONBLOCK);
+
+	if(path&&*path&&strlen(path)<sizeof(a.sun_path))
+	{
+		memset(&a,0,sizeof(a));
+		a.sun_family=AF_UNIX;
+		strcpy(a.sun_path,path);
+		unlink(path);
+		if((profile_control_socket=socket(AF_UNIX,SOCK_STREAM,0))!=-1)
+			if(fcntl(profile_control_socket,F_SETFD,FD_CLOEXEC)||
+				bind(profile_control_socket,(struct sockaddr *)&a,
+				sizeof(a))||listen(profile_control_socket,4))
+		{
+			close(profile_control_socket);
+			profile_control_socket=-1;
+		}
+		if(profile_control_socket!=-1)profile_control_path=path;
+	}
+
+	sigfillset(&set);
+	pthread_sigmask(SIG_SETMASK,&set,&old);
+	if(__builtin_expect(pthread_create(&profile_control,NULL,
+		profile_control_run,NULL),0))
+	{
+		pthread_sigmask(SIG_SETMASK,&old,NULL);
+		if(profile_control_socket!=-1)
+		{
+			close(profile_control_socket);
+			unlink(path);
+			profile_control_socket=-1;
+			profile_control_path=NULL;
+		}
+		close(profile_control_pipe[0]);
+		close(profile_control_pipe[1]);
+		return;
+	}
+	pthread_sigmask(SIG_SETMASK,&old,NULL);
+	profile_control_active=1;
+
+	if(sig>0&&sig<NSIG)
+	{
+		memset(&sa,0,sizeof(sa));
+		sa.sa_handler=profile_control_signal;
+		sa.sa_flags=SA_RESTART;
+		sigemptyset(&sa.sa_mask);
+		if(!sigaction(sig,&sa,NULL))profile_control_sig=sig;
+	}
+}
+
+static void __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_control_halt(void)
+{
+	if(!profile_control_active)return;
+	profile_control_active=0;
+	if(profile_pid!=getpid())return;
+
+	if(profile_control_sig)signal(profile_control_sig,SIG_IGN);
+	if(write(profile_control_pipe[1],"q",1)==1)
+		pthread_join(profile_control,NULL);
+	close(profile_control_pipe[0]);
+	close(profile_control_pipe[1]);
+	if(profile_control_socket!=-1)
+	{
+		close(profile_control_socket);
+		unlink(profile_control_path);
+		profile_control_socket=-1;
+	}
+}
+
+#endif
+
+static void __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_fork_prepare(void)
+{
+#ifdef _PTHREAD_H
+	lock(profile_control_mutex);
+	lock(profile_mutex);
+#ifdef PROFILE_NO_ATOMICS
+	lock(profile_pool_mutex);
+#endif
+	lock(profile_shm_mutex);
+#endif
+}
+
+static void __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_fork_parent(void)
+{
+#ifdef _PTHREAD_H
+	unlock(profile_shm_mutex);
+#ifdef PROFILE_NO_ATOMICS
+	unlock(profile_pool_mutex);
+#endif
+	unlock(profile_mutex);
+	unlock(profile_control_mutex);
+#endif
+}
+
+static int __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_fork_private(PROFILE_POOL *p)
+{
+	unsigned long len;
+	void *mem;
+	PROFILE_CHUNK *c;
+
+	for(c=p->chunk;c;c=c->next)
+	{
+		len=sizeof(PROFILE_CHUNK)+c->size*p->elsize;
+		if(__builtin_expect(!(mem=malloc(len)),0))return -1;
+		memcpy(mem,c,len);
+		if(__builtin_expect(mmap(c,len,PROT_READ|PROT_WRITE,
+			MAP_PRIVATE|MAP_ANONYMOUS|MAP_FIXED,-1,0)==MAP_FAILED,0))
+		{
+			free(mem);
+			return -1;
+		}
+		memcpy(c,mem,len);
+		free(mem);
+	}
+	p->shared=0;
+	return 0;
+}
+
+static void __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_fork_zero(PROFILE_POOL *p,int type)
+{
+	unsigned long i;
+	PROFILE_CHUNK *c;
+	PROFILE_FUNC *e;
+	PROFILE_CALLER *d;
+
+	for(c=p->chunk;c;c=c->next)
+		for(i=0;i<c->used&&i<c->size;i++)switch(type)
+	{
+	case 0:	e=(PROFILE_FUNC *)(c->data+i*p->elsize);
+		e->calls=0;
+		e->funcs=0;
+		e->time=0;
+		e->unwind=0;
+		e->depth=0;
+		e->overhead=0;
+		break;
+
+	case 1:	d=(PROFILE_CALLER *)(c->data+i*p->elsize);
+		d->calls=0;
+		d->time=0;
+		d->calling=0;
+		d->unwind=0;
+		d->overhead=0;
+		d->incl=0;
+		d->incl_overhead=0;
+		d->incl_trans=0;
+		d->wall=0;
+		break;
+
+	case 2:	memset(c->data+i*p->elsize,0,p->elsize);
+		break;
+	}
+}
+
+static void __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_fork_child(void)
+{
+	int i;
+#if defined(_PTHREAD_H) && defined(PROFILE_NO_TLS)
+	PROFILE_THREAD *tt=pthread_getspecific(profile_key);
+#else
+	PROFILE_THREAD *tt=profile_thread;
+#endif
+#ifdef _PTHREAD_H
+	int j;
+	unsigned int k;
+	PROFILE_THREAD *t;
+	PROFILE_ACTIVE *a;
+#endif
+	PROFILE_TASK *task;
+	PROFILE_STACK *p;
+
+	if(__builtin_expect(profile_error,0))return;
+
+	profile_fork_parent();
+
+#ifdef _PTHREAD_H
+	if(profile_control_active)
+	{
+		profile_control_active=0;
+		if(profile_control_sig)signal(profile_control_sig,SIG_IGN);
+		close(profile_control_pipe[0]);
+		close(profile_control_pipe[1]);
+		if(profile_control_socket!=-1)close(profile_control_socket);
+		profile_control_socket=-1;
+	}
+#endif
+
+	if(profile_shm)
+	{
+		if(__builtin_expect(profile_fork_private(&profile_fpool),0)||
+			__builtin_expect(profile_fork_private(&profile_cpool),0))
+			profile_error=1;
+		munmap(profile_shm,profile_shm->size);
+		close(profile_shm_fd);
+		profile_shm=NULL;
+		profile_shm_fd=-1;
+	}
+
+#ifdef _PTHREAD_H
+	profile_thread_free=0;
+	for(i=0;i<PROFILE_THREAD_TABLE_SIZE;i++)if(profile_thread_table[i])
+		for(j=0;j<PROFILE_THREAD_BLOCK_SIZE;j++)
+	{
+		if(!(t=profile_thread_table[i][j])||t==tt)continue;
+		if(t->busy)
+		{
+			profile_nodes_free(t->root,t->nodes);
+			profile_tables_free(&t->tables);
+			profile_clock_close(t);
+			profile_event_close(t);
+			for(k=0;k<=t->active_mask;k++)
+				for(a=t->active[k];a;a=a->next)a->count=0;
+			t->busy=0;
+		}
+		profile_thread_push(t);
+	}
+#endif
+
+	while(profile_tasks)
+	{
+		task=profile_tasks;
+		profile_tasks=task->next;
+		profile_nodes_free(task->root,task->nodes);
+		free(task);
+	}
+	while(profile_task_groups)
+	{
+		task=profile_task_groups;
+		profile_task_groups=task->next;
+		free(task);
+	}
+	profile_task_count=0;
+
+	profile_fork_zero(&profile_fpool,0);
+	profile_fork_zero(&profile_cpool,1);
+	if(profile_cct)profile_fork_zero(&profile_npool,1);
+	if(profile_hist)profile_fork_zero(&profile_hpool,2);
+	if(profile_sharded)profile_fork_zero(&profile_spool,2);
+	if(profile_events)profile_fork_zero(&profile_epool,2);
+	if(profile_alloc)profile_fork_zero(&profile_apool,2);
+
+#ifdef _PTHREAD_H
+	profile_numthreads=0;
+#endif
+	profile_cache_hits=0;
+	profile_cache_misses=0;
+	profile_recovered=0;
+
+	if(tt)
+	{
+		tt->time=0;
+		tt->overhead=0;
+		tt->funcs=0;
+		tt->unwind=0;
+		tt->maxdepth=0;
+		tt->cache_hits=0;
+		tt->cache_misses=0;
+		tt->sum_calls=0;
+		tt->sum_funcs=0;
+		tt->sum_time=0;
+		tt->sum_overhead=0;
+		tt->sum_unwind=0;
+		tt->birth=profile_wall_read();
+		tt->recovered=0;
+		tt->tid=syscall(SYS_gettid);
+		for(i=1,p=&tt->stack[1];i<=tt->stack_index;i++,p++)
+		{
+			p->used=0;
+			p->overhead=0;
+			p->wused=0;
+			p->time0=0;
+			p->overhead0=0;
+			p->funcs0=0;
+			p->allocs=0;
+			p->frees=0;
+			p->abytes=0;
+			p->atime=0;
+		}
+#ifdef _PTHREAD_H
+		if(tt->stack_index)profile_numthreads=1;
+#endif
+		profile_clock_close(tt);
+		profile_clock_open(tt);
+		profile_event_close(tt);
+		profile_event_open(tt);
+		profile_clock_read(tt,&tt->start_time);
+		if(profile_wall)tt->wstart=profile_wall_read();
+	}
+#ifdef _PTHREAD_H
+	profile_maxthreads=profile_numthreads;
+#endif
+
+	profile_ppid=profile_self;
+	profile_self=getpid();
+	if(profile_log_template)profile_log_expand();
+	clock_gettime(CLOCK_MONOTONIC,&profile_process_time);
+}
+
+static void __attribute__((no_instrument_function)) __attribute__((cold))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	profile_fork_init(void)
+{
+	pthread_atfork(profile_fork_prepare,profile_fork_parent,
+		profile_fork_child);
+}
+
+void __attribute__ ((destructor)) __attribute__((no_instrument_function))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	__attribute__((cold)) profile_fini(void)
+{
+#ifdef _PTHREAD_H
+	int i;
+	int j;
+#endif
+#if defined(_PTHREAD_H) && defined(PROFILE_NO_TLS)
+	PROFILE_THREAD *tt=pthread_getspecific(profile_key);
 #else
-	profile_gettime(CLOCK_THREAD_CPUTIME_ID,&stamp);
+	PROFILE_THREAD *tt=profile_thread;
 #endif
+	FILE *fp;
+	PROFILE_TASK *task;
+	PROFILE_NODE *node;
+	char *data=NULL;
+	struct timespec stamp;
+	struct timespec cpu;
+	struct rusage r;
+	unsigned long used;
+	unsigned long size;
 
-	if(__builtin_expect(!tt,0))
+	if(__builtin_expect(profile_disabled,0))return;
+
+	profile_heap_on=0;
+#ifdef _PTHREAD_H
+	profile_control_halt();
+#endif
+
+	if(profile_self!=getpid())
+	{
+		profile_ppid=profile_self;
+		profile_self=getpid();
+		if(profile_log_template)profile_log_expand();
+	}
+
+	if(__builtin_expect(profile_gettime(CLOCK_PROCESS_CPUTIME_ID,&cpu),0))
+		goto timeerr;
+
+	if(__builtin_expect(clock_gettime(CLOCK_MONOTONIC,&stamp),0))
+		goto timeerr;
+
+	if(__builtin_expect(getrusage(RUSAGE_SELF,&r),0))
+	{
+timeerr:	profile_time_error=1;
+		goto fail;
+	}
+
+#ifdef _PTHREAD_H
+	if(__builtin_expect(!profile_error,1))
+	{
+		for(i=0;i<PROFILE_THREAD_TABLE_SIZE;i++)if(profile_thread_table[i])
+		{
+			for(j=0;j<PROFILE_THREAD_BLOCK_SIZE;j++)
+				if((tt=profile_thread_table[i][j]))
+			{
+				if(tt->busy)
+				{
+					profile_stack_unwind(tt,0,0);
+					if(profile_cct)profile_node_fold(tt);
+					profile_task_save(tt);
+					profile_merge(tt);
+					profile_clock_close(tt);
+					profile_event_close(tt);
+				}
+				profile_tables_free(&tt->tables);
+				profile_active_free(tt);
+				free(tt->stack);
+				free(tt);
+			}
+			free(profile_thread_table[i]);
+			profile_thread_table[i]=NULL;
+		}
+		profile_table_next=0;
+		profile_thread_free=0;
+	}
+#else
+	if(__builtin_expect(!profile_error,1)&&tt)
+	{
+		profile_stack_unwind(tt,0,0);
+		if(profile_cct)profile_node_fold(tt);
+		profile_task_save(tt);
+		profile_clock_close(tt);
+		profile_event_close(tt);
+		profile_active_free(tt);
+		free(tt->stack);
+		free(tt);
+	}
+#endif
+#if !defined(_PTHREAD_H) || !defined(PROFILE_NO_TLS)
+	profile_thread=NULL;
+#endif
+
+	if(__builtin_expect(!profile_error,1))
+	{
+#ifdef _PTHREAD_H
+		pthread_setspecific(profile_key,NULL);
+		pthread_key_delete(profile_key);
+#endif
+
+		profile_deltatime(stamp,profile_process_time);
+
+		if(!(data=malloc(2*PATH_MAX)))
+		{
+fail:			profile_error=1;
+		}
+	}
+
+	if(!profile_log_perproc)
+	{
+		if(profile_pid==getpid())
+		{
+			if(profile_daemon)goto out;
+		}
+		else if(!profile_daemon)goto out;
+	}
+
+	if(__builtin_expect((fp=fopen(profile_log_file,"we"))!=NULL,1))
+	{
+		if(__builtin_expect(!profile_error,1))
+		{
+			profile_shard_fold(&profile_tables);
+			if(profile_binary&&__builtin_expect(
+				profile_dump_binary(&profile_tables,data,fp),0))
+				profile_binary=0;
+			profile_dump_cmd(data,fp);
+			fprintf(fp,"INFO: pid %d\n",profile_self);
+			fprintf(fp,"INFO: ppid %d\n",profile_ppid);
+			fprintf(fp,"INFO: runtime %llu\n",profile_nsecs(stamp));
+			fprintf(fp,"INFO: cpu-usage %llu\n",profile_nsecs(cpu));
+			fprintf(fp,"INFO: clock %s %llu\n",profile_clock_name(),
+				profile_clock_freq);
+			if(profile_clock_fallback)
+				fprintf(fp,"INFO: clock-fallback %s\n",
+					profile_clock_fallback);
+			if(profile_clock_threads)
+				fprintf(fp,"INFO: clock-fallback-threads %d\n",
+					profile_clock_threads);
+			fprintf(fp,"INFO: overhead %llu\n",profile_overhead);
+			profile_event_info(fp);
+			if(profile_hist)fprintf(fp,"INFO: hist-bits %d\n",
+				PROFILE_HIST_BITS);
+			if(profile_wall)fprintf(fp,"INFO: wallclock 1\n");
+			fprintf(fp,"INFO: cache-hits %llu\n",profile_cache_hits);
+			fprintf(fp,"INFO: cache-misses %llu\n",
+				profile_cache_misses);
+			if(profile_recovered)fprintf(fp,"INFO: recovered %llu\n",
+				profile_recovered);
+			fprintf(fp,"INFO: maxrss %lu\n",r.ru_maxrss);
+			profile_pool_usage(&profile_fpool,&used,&size);
+			fprintf(fp,"INFO: f-pool-use %lu\n",used);
+			fprintf(fp,"INFO: f-pool-size %lu\n",size);
+			fprintf(fp,"INFO: f-pool-mem %lu\n",
+				profile_fpool.elsize*size);
+			profile_pool_usage(&profile_cpool,&used,&size);
+			fprintf(fp,"INFO: c-pool-use %lu\n",used);
+			fprintf(fp,"INFO: c-pool-size %lu\n",size);
+			fprintf(fp,"INFO: c-pool-mem %lu\n",
+				profile_cpool.elsize*size);
+			if(profile_sharded)
+			{
+				profile_pool_usage(&profile_spool,&used,&size);
+				fprintf(fp,"INFO: shards %u\n",profile_shards);
+				fprintf(fp,"INFO: s-pool-mem %lu\n",
+					profile_spool.elsize*size);
+			}
+			fprintf(fp,"INFO: stack-size %d\n",
+				profile_stack_limit-1);
+			fprintf(fp,"INFO: thread-mem %d\n",profile_thread_size);
+#ifdef _PTHREAD_H
+			fprintf(fp,"INFO: max-threads %d\n",profile_maxthreads);
+#else
+			fprintf(fp,"INFO: max-threads %d\n",1);
+#endif
+			for(task=profile_tasks;task;task=task->next)
+				fprintf(fp,"STACK: %d %llu %llu\n",task->id,
+					task->depth,task->frames);
+			for(task=profile_tasks;task;task=task->next)
+				fprintf(fp,"TASK: %d %d %llu %llu %llu %llu "
+					"%llu %llu %llu %s\n",task->id,task->tid,
+					task->calls,task->funcs,task->time,
+					task->overhead,task->unwind,task->depth,
+					task->lifetime,task->name);
+			for(task=profile_task_groups;task;task=task->next)
+				fprintf(fp,"TASKS: %u %llu %llu %llu %llu %llu "
+					"%llu %llu %llu %llu %s\n",task->threads,
+					task->calls,task->funcs,task->time,
+					task->overhead,task->unwind,task->depth,
+					task->frames,task->maxtime,
+					task->lifetime,task->name);
+			if(profile_cct)
+			{
+				profile_pool_usage(&profile_npool,&used,&size);
+				fprintf(fp,"INFO: n-pool-use %lu\n",used);
+				fprintf(fp,"INFO: n-pool-size %lu\n",size);
+				fprintf(fp,"INFO: n-pool-mem %lu\n",
+					profile_npool.elsize*size);
+			}
+			if(!profile_binary)profile_dump_maps(data,fp,0);
+			profile_tables_walk(&profile_tables,fp);
+			for(task=profile_tasks;task;task=task->next)
+				for(node=task->nodes;node;node=node->next)
+					fprintf(fp,"CCT: %d %d %d %p %p %llu "
+						"%llu %llu %u %llu\n",task->id,
+						node->id,node->parent->id,
+						node->c.func,node->c.caller,
+						node->c.calls,node->c.time,
+						node->c.calling,node->c.unwind,
+						node->c.overhead);
+		}
+		else if(!profile_func_exhausted&&!profile_caller_exhausted&&
+		    !profile_node_exhausted&&!profile_stack_exhausted&&
+		    !profile_memory_error&&!profile_time_error)
+			fprintf(fp,"ERROR: internal or resource problem\n");
+
+		if(__builtin_expect(profile_func_exhausted,0))
+		    fprintf(fp,"ERROR: func pool exhausted\n");
+		if(__builtin_expect(profile_caller_exhausted,0))
+		    fprintf(fp,"ERROR: caller pool exhausted\n");
+		if(__builtin_expect(profile_node_exhausted,0))
+		    fprintf(fp,"ERROR: node pool exhausted\n");
+		if(__builtin_expect(profile_stack_exhausted,0))
+		    fprintf(fp,"ERROR: time stack exhausted\n");
+		if(__builtin_expect(profile_memory_error,0))
+		    fprintf(fp,"ERROR: memory allocation failure\n");
+		if(__builtin_expect(profile_time_error,0))
+		    fprintf(fp,"ERROR: time access failure\n");
+
+		fclose(fp);
+	}
+
+out:	profile_error=1;
+	if(__builtin_expect(data!=NULL,1))free(data);
+	while(profile_tasks)
+	{
+		task=profile_tasks;
+		profile_tasks=task->next;
+		profile_nodes_free(task->root,task->nodes);
+		free(task);
+	}
+	while(profile_task_groups)
 	{
+		task=profile_task_groups;
+		profile_task_groups=task->next;
+		free(task);
+	}
+	profile_task_count=0;
+	profile_tables_free(&profile_tables);
+	profile_func_spare=NULL;
+	profile_caller_spare=NULL;
+	profile_pool_free(&profile_fpool);
+	profile_pool_free(&profile_cpool);
+	profile_pool_free(&profile_npool);
+	profile_pool_free(&profile_hpool);
+	profile_pool_free(&profile_spool);
+	profile_pool_free(&profile_epool);
+	profile_pool_free(&profile_apool);
+	profile_pool_free(&profile_rpool);
+	profile_snap_free();
+	profile_shm_close();
+}
+
+void __attribute__((no_instrument_function)) __attribute__((hot))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	__attribute__((optimize("Os")))
+	__cyg_profile_func_enter(void *func,void *caller)
+{
+	PROFILE_CALLER *c;
+	PROFILE_STACK *p;
+#if defined(_PTHREAD_H) && defined(PROFILE_NO_TLS)
+	PROFILE_THREAD *tt=pthread_getspecific(profile_key);
+#else
+	PROFILE_THREAD *tt=profile_thread;
+#endif
+	unsigned long long stamp;
+	unsigned long long wstamp=0;
+
+	if(__builtin_expect(profile_stopped,0))return;
+	if(__builtin_expect(profile_error,0))return;
+	if(__builtin_expect(profile_filter,0)&&profile_filtered(func))return;
+
 #ifdef PROFILE_STRICT
-		if(__builtin_expect(!(tt=malloc(profile_thread_size)),0))
+	if(__builtin_expect(profile_clock_read(tt,&stamp),0))goto timeerr;
+#else
+	profile_clock_read(tt,&stamp);
+#endif
+	if(__builtin_expect(profile_wall,0))wstamp=profile_wall_read();
+
+	if(__builtin_expect(!tt,0))
+	{
+#ifdef _PTHREAD_H
+		if(!(tt=profile_thread_pop()))
+#endif
+		if(__builtin_expect(!(tt=profile_thread_new()),0))
+		{
+			profile_stack_exhausted=1;
+			goto fail;
+		}
+#ifdef _PTHREAD_H
+		if(profile_private&&!tt->tables.func&&
+			__builtin_expect(profile_tables_alloc(&tt->tables),0))
 		{
+			profile_thread_push(tt);
 			profile_stack_exhausted=1;
 			goto fail;
 		}
+#endif
+		profile_active_clear(tt);
+		tt->nodes=NULL;
+		tt->node_count=0;
+		if(profile_cct)
+		{
+			if(__builtin_expect(!(tt->root=profile_node_new(tt,
+				NULL,NULL,NULL)),0))goto fail;
+			tt->stack[0].c=&tt->root->c;
+		}
+		else tt->root=NULL;
+		tt->stack_index=0;
+		tt->depth=0;
+		tt->maxdepth=0;
+		profile_cache_clear(tt);
+#if defined(_PTHREAD_H) && !defined(PROFILE_NO_ATOMICS)
+		tt->id=__atomic_add_fetch(&profile_thread_count,1,
+			__ATOMIC_RELAXED);
+#elif defined(_PTHREAD_H)
+		lock(profile_mutex);
+		tt->id=++profile_thread_count;
+		unlock(profile_mutex);
+#else
+		tt->id=++profile_thread_count;
+#endif
+		tt->tid=syscall(SYS_gettid);
+		if(prctl(PR_GET_NAME,tt->name))*tt->name=0;
+		tt->name[sizeof(tt->name)-1]=0;
+		tt->sum_calls=0;
+		tt->sum_funcs=0;
+		tt->sum_time=0;
+		tt->sum_overhead=0;
+		tt->sum_unwind=0;
+		tt->birth=profile_wall_read();
+		tt->recovered=0;
+		tt->epoch=profile_epoch;
+		tt->reset=profile_load(profile_reset_epoch);
+		tt->stack[0].func=NULL;
+		profile_clock_open(tt);
+		profile_event_open(tt);
+#ifdef PROFILE_STRICT
+		if(__builtin_expect(profile_clock_read(tt,&stamp),0))
+			goto timeerr;
 #else
-		tt=malloc(profile_thread_size);
+		profile_clock_read(tt,&stamp);
+#endif
+		if(profile_wall)wstamp=profile_wall_read();
+#ifdef _PTHREAD_H
+		tt->busy=1;
+		pthread_setspecific(profile_key,tt);
+#endif
+#if !defined(_PTHREAD_H) || !defined(PROFILE_NO_TLS)
+		profile_thread=tt;
 #endif
+	}
+	else if(__builtin_expect(tt->epoch!=profile_epoch,0))
+	{
+		tt->epoch=profile_epoch;
+		tt->start_time=stamp;
+		tt->wstart=wstamp;
+		if(profile_events)profile_event_charge(tt,NULL);
+	}
+	if(__builtin_expect(tt->reset!=profile_load(profile_reset_epoch),0))
+		profile_thread_reset(tt);
+
+	if(__builtin_expect(profile_events,0))profile_event_charge(tt,
+		tt->stack_index?tt->stack[tt->stack_index].c:NULL);
+
+	if(__builtin_expect(!tt->stack_index,0))
+	{
 		p=tt->stack;
-		tt->stack_index=0;
+		if(tt->depth>tt->maxdepth)tt->maxdepth=tt->depth;
 		tt->unwind=0;
 		tt->depth=0;
 		tt->funcs=0;
-		tt->nsecs=0;
-		tt->secs=0;
+		tt->time=0;
+		tt->overhead=0;
 #ifdef _PTHREAD_H
-		tt->table_index=profile_table_next;
-		tt->next=profile_thread_table[tt->table_index];
-		profile_thread_table[tt->table_index]=tt;
-		if((profile_table_next+=1)==PROFILE_THREAD_TABLE_SIZE)
-		    profile_table_next=0;
-		pthread_setspecific(profile_key,tt);
 #ifndef PROFILE_NO_ATOMICS
 		{
 			unsigned int n;
@@ -839,217 +6256,111 @@ repeat:			t=__atomic_load_n(&profile_maxthreads,__ATOMIC_SEQ_CST);
 #endif
 #else
 		if(++profile_numthreads>1)goto fail;
-#endif
-#if !defined(_PTHREAD_H) || !defined(PROFILE_NO_TLS)
-		profile_thread=tt;
 #endif
 	}
 	else
 	{
-		profile_deltatime(stamp,tt->start_time);
-
 		p=&tt->stack[tt->stack_index];
-		p->used.tv_nsec+=stamp.tv_nsec;
-		p->used.tv_sec+=stamp.tv_sec;
+		profile_charge(tt,p,stamp);
+		if(__builtin_expect(profile_wall,0))p->wused+=wstamp-tt->wstart;
 
-#if defined(_PTHREAD_H) && !defined(PROFILE_NO_ATOMICS)
-		__atomic_add_fetch(&p->c->calling,1,__ATOMIC_RELAXED);
-#else
 #ifdef _PTHREAD_H
-		lock(profile_mutex);
-#endif
-		p->c->calling++;
-#ifdef _PTHREAD_H
-		unlock(profile_mutex);
-#endif
-#endif
-	}
-
-	if(__builtin_expect(++(tt->stack_index)==profile_stack_limit,0))
-	{
-		profile_stack_exhausted=1;
-		goto err;
-	}
-	else if(tt->stack_index>tt->depth)tt->depth=tt->stack_index;
-	tt->funcs++;
-	p++;
-
-#if defined(_PTHREAD_H) && !defined(PROFILE_NO_ATOMICS)
-
-	e=&profile_root[(((unsigned long)func)>>4)&(PROFILE_FUNC_TABLE_SIZE-1)];
-
-eagain:	if((m.e=__atomic_load_n(e,__ATOMIC_SEQ_CST)))
-	{
-		if(m.e->func<func)
-		{
-			e=&m.e->left;
-			goto eagain;
-		}
-		if(m.e->func>func)
-		{
-			e=&m.e->right;
-			goto eagain;
-		}
-	}
-	else
-	{
-		lock(profile_mutex);
-		if(__builtin_expect(__atomic_load_n(e,__ATOMIC_SEQ_CST)
-			!=NULL,0))
-		{
-			unlock(profile_mutex);
-			goto eagain;
-		}
-		if(__builtin_expect(profile_fpool_used==profile_fpool_limit,0))
-		{
-			profile_func_exhausted=1;
-			goto err;
-		}
-		m.e=&profile_func_alloc[profile_fpool_used++];
-		m.e->func=func;
-		__atomic_store_n(e,m.e,__ATOMIC_SEQ_CST);
-		unlock(profile_mutex);
-	}
-
-	c=&(*e)->caller[(((unsigned long)caller)>>4)&
-		(PROFILE_CALLER_TABLE_SIZE-1)];
-
-cagain:	if((m.c=__atomic_load_n(c,__ATOMIC_SEQ_CST)))
-	{
-		if(m.c->caller<caller)
-		{
-			c=&m.c->left;
-			goto cagain;
-		}
-		if(m.c->caller>caller)
-		{
-			c=&m.c->right;
-			goto cagain;
-		}
-	}
-	else
-	{
-		lock(profile_mutex2);
-		if(__builtin_expect(__atomic_load_n(c,__ATOMIC_SEQ_CST)
-			!=NULL,0))
+		if(profile_private)p->c->calling++;
+		else
 		{
-			unlock(profile_mutex2);
-			goto cagain;
-		}
-		if(__builtin_expect(profile_cpool_used==profile_cpool_limit,0))
-		{
-			profile_caller_exhausted=1;
-			goto err2;
-		}
-		m.c=&profile_caller_alloc[profile_cpool_used++];
-		m.c->caller=caller;
-		__atomic_store_n(c,m.c,__ATOMIC_SEQ_CST);
-		unlock(profile_mutex2);
-	}
-
-	__atomic_add_fetch(&m.c->calls,1,__ATOMIC_RELAXED);
-
+#ifndef PROFILE_NO_ATOMICS
+			if(profile_sharded)__atomic_add_fetch(
+				&profile_shard(p->c)->calling,1,
+				__ATOMIC_RELAXED);
+			else __atomic_add_fetch(&p->c->calling,1,
+				__ATOMIC_RELAXED);
 #else
-
-#ifdef _PTHREAD_H
-	lock(profile_mutex);
+			lock(profile_mutex);
+			p->c->calling++;
+			unlock(profile_mutex);
 #endif
-
-	e=&profile_root[(((unsigned long)func)>>4)&(PROFILE_FUNC_TABLE_SIZE-1)];
-
-	while(*e)
-	{
-		if((*e)->func<func)e=&(*e)->left;
-		else  if((*e)->func>func)e=&(*e)->right;
-		else break;
-	}
-
-	if(!*e)
-	{
-		if(__builtin_expect(profile_fpool_used==profile_fpool_limit,0))
-		{
-			profile_func_exhausted=1;
-			goto err;
 		}
-		*e=&profile_func_alloc[profile_fpool_used++];
-		(*e)->func=func;
-	}
-
-	c=&(*e)->caller[(((unsigned long)caller)>>4)&
-		(PROFILE_CALLER_TABLE_SIZE-1)];
-
-	while(*c)
-	{
-		if((*c)->caller<caller)c=&(*c)->left;
-		else  if((*c)->caller>caller)c=&(*c)->right;
-		else break;
+#else
+		p->c->calling++;
+#endif
 	}
 
-	if(!*c)
+	if(__builtin_expect(++(tt->stack_index)==tt->stack_size,0))
 	{
-		if(__builtin_expect(profile_cpool_used==profile_cpool_limit,0))
+		if(__builtin_expect(profile_stack_grow(tt),0))
 		{
-			profile_caller_exhausted=1;
-			goto err;
+			profile_stack_exhausted=1;
+			goto fail;
 		}
-		*c=&profile_caller_alloc[profile_cpool_used++];
-		(*c)->caller=caller;
+		p=&tt->stack[tt->stack_index-1];
 	}
-
-	(*c)->calls++;
+	if(tt->stack_index>tt->depth)tt->depth=tt->stack_index;
+	tt->funcs++;
+	p++;
 
 #ifdef _PTHREAD_H
-	unlock(profile_mutex);
-#endif
-
-#endif
-
-	p->e=*e;
-	p->c=*c;
-	p->used.tv_nsec=0;
-	p->used.tv_sec=0;
-
-#ifdef PROFILE_STRICT
-	if(__builtin_expect(profile_gettime(CLOCK_THREAD_CPUTIME_ID,
-		&tt->start_time),0))
+	if(profile_private)
+	{
+		if(profile_cct)c=profile_node_lookup(tt,(PROFILE_NODE *)p[-1].c,
+			func,caller);
+		else c=profile_cache_lookup(tt,&tt->tables,func,caller);
+		if(__builtin_expect(!c,0))goto fail;
+		c->calls++;
+	}
+	else
 	{
-timeerr:	profile_time_error=1;
-#ifdef _PTHREAD_H
 #ifndef PROFILE_NO_ATOMICS
-		if(0)
-		{
-err2:			unlock(profile_mutex2);
-		}
-#endif
-		if(0)
-		{
-err:			unlock(profile_mutex);
-		}
+		if(__builtin_expect(!(c=profile_cache_lookup(tt,
+			&profile_tables,func,caller)),0))goto fail;
+		if(profile_sharded)__atomic_add_fetch(&profile_shard(c)->calls,
+			1,__ATOMIC_RELAXED);
+		else __atomic_add_fetch(&c->calls,1,__ATOMIC_RELAXED);
 #else
-err:
+		lock(profile_mutex);
+		if(__builtin_expect(!(c=profile_cache_lookup(tt,
+			&profile_tables,func,caller)),0))goto err;
+		c->calls++;
+		unlock(profile_mutex);
 #endif
-fail:		profile_error=1;
-		return;
 	}
 #else
-	profile_gettime(CLOCK_THREAD_CPUTIME_ID,&tt->start_time);
-	return;
+	if(profile_cct)c=profile_node_lookup(tt,(PROFILE_NODE *)p[-1].c,func,
+		caller);
+	else c=profile_cache_lookup(tt,&profile_tables,func,caller);
+	if(__builtin_expect(!c,0))goto fail;
+	c->calls++;
+#endif
 
-#if defined(_PTHREAD_H) && !defined(PROFILE_NO_ATOMICS)
-err2:	unlock(profile_mutex2);
-	profile_error=1;
+	if(__builtin_expect(!(p->active=profile_active_get(tt,c->e)),0))
+		goto fail;
+	p->active->count++;
+	p->e=c->e;
+	p->c=c;
+	p->used=0;
+	p->overhead=0;
+	p->time0=tt->time;
+	p->overhead0=tt->overhead;
+	p->funcs0=tt->funcs;
+	p->wused=0;
+	p->func=func;
+	p->allocs=0;
+	p->frees=0;
+	p->abytes=0;
+	p->atime=0;
+	p->epoch=tt->epoch;
+
+	tt->start_time=stamp;
+	tt->wstart=wstamp;
 	return;
+
+#ifdef PROFILE_STRICT
+timeerr:profile_time_error=1;
+	goto fail;
 #endif
-#ifdef _PTHREAD_H
+#if defined(_PTHREAD_H) && defined(PROFILE_NO_ATOMICS)
 err:	unlock(profile_mutex);
-	profile_error=1;
-	return;
-#else
-fail:
-err:	profile_error=1;
-	return;
-#endif
 #endif
+fail:	profile_error=1;
 }
 
 void __attribute__((no_instrument_function)) __attribute__((hot))
@@ -1063,76 +6374,182 @@ void __attribute__((no_instrument_function)) __attribute__((hot))
 	__attribute__((optimize("Os")))
 	__cyg_profile_func_exit(void *func,void *caller)
 {
+	int outer;
 	PROFILE_STACK *p;
-#ifdef _PTHREAD_H
-	PROFILE_THREAD **t;
-#endif
 #if defined(_PTHREAD_H) && defined(PROFILE_NO_TLS)
 	PROFILE_THREAD *tt=pthread_getspecific(profile_key);
 #else
 	PROFILE_THREAD *tt=profile_thread;
 #endif
-	struct timespec stamp;
+	unsigned long long stamp;
+	unsigned long long wstamp=0;
 
+	if(__builtin_expect(profile_stopped,0))return;
 	if(__builtin_expect(profile_error,0))return;
+	if(__builtin_expect(profile_filter,0)&&profile_filtered(func))return;
 
 #ifdef PROFILE_STRICT
-	if(__builtin_expect(profile_gettime(CLOCK_THREAD_CPUTIME_ID,&stamp),0))
-		goto timeerr;
+	if(__builtin_expect(profile_clock_read(tt,&stamp),0))goto timeerr;
 #else
-	profile_gettime(CLOCK_THREAD_CPUTIME_ID,&stamp);
+	profile_clock_read(tt,&stamp);
 #endif
+	if(__builtin_expect(profile_wall,0))wstamp=profile_wall_read();
+
+	if(__builtin_expect(!tt||tt->epoch!=profile_epoch,0))
+	{
+		if(!tt)return;
+		tt->epoch=profile_epoch;
+		tt->start_time=stamp;
+		tt->wstart=wstamp;
+		if(profile_events)profile_event_charge(tt,NULL);
+	}
 
 	p=&tt->stack[tt->stack_index];
 
+	if(__builtin_expect(p->func!=func,0))
+	{
+		if(profile_stack_recover(tt,func,caller))return;
+		p=&tt->stack[tt->stack_index];
+	}
+
 #ifdef PROFILE_STRICT
-	if(__builtin_expect(p->e->func!=func,0)||
-		__builtin_expect(p->c->caller!=caller,0))goto err;
+	if(__builtin_expect(p->c->caller!=caller,0))goto err;
 #endif
 
-	profile_deltatime(stamp,tt->start_time);
+	profile_charge(tt,p,stamp);
+	if(__builtin_expect(profile_wall,0))
+	{
+		p->wused+=wstamp-tt->wstart;
+		profile_wall_add(p->c,p->wused);
+	}
+	if(__builtin_expect(profile_events,0))profile_event_charge(tt,p->c);
+	if(profile_alloc)profile_heap_charge(p,0);
 
-#if defined(_PTHREAD_H) && !defined(PROFILE_NO_ATOMICS)
+	tt->time+=p->used;
+	tt->overhead+=p->overhead;
+	outer=!--p->active->count;
 
-	__atomic_add_fetch(&p->c->nsecs,p->used.tv_nsec+stamp.tv_nsec,
-		__ATOMIC_RELAXED);
-	__atomic_add_fetch(&p->c->secs,p->used.tv_sec+stamp.tv_sec,
-		__ATOMIC_RELAXED);
+#ifdef _PTHREAD_H
 
-#else
+	if(profile_private)
+	{
+		p->c->time+=p->used;
+		p->c->overhead+=p->overhead;
+		if(__builtin_expect(outer,1))
+		{
+			p->c->incl+=tt->time-p->time0;
+			p->c->incl_overhead+=tt->overhead-p->overhead0;
+			p->c->incl_trans+=((tt->funcs-p->funcs0)<<1)+1;
+		}
+		if(__builtin_expect(profile_hist,0))profile_hist_add(p->e->hist,
+			tt->time-p->time0-tt->overhead+p->overhead0,0);
+	}
+	else
+	{
+#ifndef PROFILE_NO_ATOMICS
+		if(profile_sharded)
+		{
+			PROFILE_SHARD *s=profile_shard(p->c);
 
-#ifdef _PTHREAD_H
-	lock(profile_mutex);
+			__atomic_add_fetch(&s->time,p->used,__ATOMIC_RELAXED);
+			__atomic_add_fetch(&s->overhead,p->overhead,
+				__ATOMIC_RELAXED);
+			if(__builtin_expect(outer,1))
+			{
+				__atomic_add_fetch(&s->incl,tt->time-p->time0,
+					__ATOMIC_RELAXED);
+				__atomic_add_fetch(&s->incl_overhead,
+					tt->overhead-p->overhead0,
+					__ATOMIC_RELAXED);
+				__atomic_add_fetch(&s->incl_trans,
+					((tt->funcs-p->funcs0)<<1)+1,
+					__ATOMIC_RELAXED);
+			}
+		}
+		else
+		{
+			__atomic_add_fetch(&p->c->time,p->used,
+				__ATOMIC_RELAXED);
+			__atomic_add_fetch(&p->c->overhead,p->overhead,
+				__ATOMIC_RELAXED);
+			if(__builtin_expect(outer,1))
+			{
+				__atomic_add_fetch(&p->c->incl,
+					tt->time-p->time0,__ATOMIC_RELAXED);
+				__atomic_add_fetch(&p->c->incl_overhead,
+					tt->overhead-p->overhead0,
+					__ATOMIC_RELAXED);
+				__atomic_add_fetch(&p->c->incl_trans,
+					((tt->funcs-p->funcs0)<<1)+1,
+					__ATOMIC_RELAXED);
+			}
+		}
+		if(__builtin_expect(profile_hist,0))profile_hist_add(p->e->hist,
+			tt->time-p->time0-tt->overhead+p->overhead0,1);
+#else
+		lock(profile_mutex);
+		p->c->time+=p->used;
+		p->c->overhead+=p->overhead;
+		if(__builtin_expect(outer,1))
+		{
+			p->c->incl+=tt->time-p->time0;
+			p->c->incl_overhead+=tt->overhead-p->overhead0;
+			p->c->incl_trans+=((tt->funcs-p->funcs0)<<1)+1;
+		}
+		if(__builtin_expect(profile_hist,0))profile_hist_add(p->e->hist,
+			tt->time-p->time0-tt->overhead+p->overhead0,0);
+		unlock(profile_mutex);
 #endif
+	}
 
-	p->c->nsecs+=p->used.tv_nsec+stamp.tv_nsec;
-	p->c->secs+=p->used.tv_sec+stamp.tv_sec;
+#else
 
-#ifdef _PTHREAD_H
-	unlock(profile_mutex);
-#endif
+	p->c->time+=p->used;
+	p->c->overhead+=p->overhead;
+	if(__builtin_expect(outer,1))
+	{
+		p->c->incl+=tt->time-p->time0;
+		p->c->incl_overhead+=tt->overhead-p->overhead0;
+		p->c->incl_trans+=((tt->funcs-p->funcs0)<<1)+1;
+	}
+	if(__builtin_expect(profile_hist,0))profile_hist_add(p->e->hist,
+		tt->time-p->time0-tt->overhead+p->overhead0,0);
 
 #endif
 
-	tt->nsecs+=p->used.tv_nsec+stamp.tv_nsec;
-	tt->secs+=p->used.tv_sec+stamp.tv_sec;
-
 	if(__builtin_expect(!(--(tt->stack_index)),0))
 	{
+		tt->sum_calls++;
+		tt->sum_funcs+=tt->funcs;
+		tt->sum_time+=tt->time;
+		tt->sum_overhead+=tt->overhead;
+		tt->sum_unwind+=tt->unwind;
 #if defined(_PTHREAD_H) && !defined(PROFILE_NO_ATOMICS)
-		__atomic_add_fetch(&p->e->funcs,tt->funcs,__ATOMIC_RELAXED);
-		__atomic_add_fetch(&p->e->calls,1,__ATOMIC_RELAXED);
-		__atomic_add_fetch(&p->e->secs,tt->secs,__ATOMIC_RELAXED);
-		__atomic_add_fetch(&p->e->nsecs,tt->nsecs,__ATOMIC_RELAXED);
+		if(profile_private)
+		{
+			p->e->funcs+=tt->funcs;
+			p->e->calls++;
+			p->e->time+=tt->time;
+			p->e->overhead+=tt->overhead;
+			if(tt->depth>p->e->depth)p->e->depth=tt->depth;
+		}
+		else
 		{
-			unsigned long long depth;
+			unsigned int depth;
 
+			__atomic_add_fetch(&p->e->funcs,tt->funcs,
+				__ATOMIC_RELAXED);
+			__atomic_add_fetch(&p->e->calls,1,__ATOMIC_RELAXED);
+			__atomic_add_fetch(&p->e->time,tt->time,
+				__ATOMIC_RELAXED);
+			__atomic_add_fetch(&p->e->overhead,tt->overhead,
+				__ATOMIC_RELAXED);
 repeat:			depth= __atomic_load_n(&p->e->depth,__ATOMIC_SEQ_CST);
 			if(tt->depth>depth)if(__builtin_expect(
 				!__atomic_compare_exchange_n(&p->e->depth,
 				&depth,tt->depth,1,__ATOMIC_SEQ_CST,
 				__ATOMIC_RELAXED),0))goto repeat;
-		};
+		}
 		__atomic_sub_fetch(&profile_numthreads,1,__ATOMIC_SEQ_CST);
 #else
 #ifdef _PTHREAD_H
@@ -1140,41 +6557,259 @@ repeat:			depth= __atomic_load_n(&p->e->depth,__ATOMIC_SEQ_CST);
 #endif
 		p->e->funcs+=tt->funcs;
 		p->e->calls++;
-		p->e->secs+=tt->secs;
-		p->e->nsecs+=tt->nsecs;
+		p->e->time+=tt->time;
+		p->e->overhead+=tt->overhead;
 		if(tt->depth>p->e->depth)p->e->depth=tt->depth;
 		profile_numthreads--;
 #ifdef _PTHREAD_H
 		unlock(profile_mutex);
 #endif
 #endif
-#ifdef _PTHREAD_H
-		for(t=&profile_thread_table[tt->table_index];*t;t=&(*t)->next)
-			if(*t==tt)
-		{
-			*t=tt->next;
-			break;
-		}
-#endif
-		free(tt);
-#ifdef _PTHREAD_H
-		pthread_setspecific(profile_key,NULL);
+	}
+	else
+	{
+		tt->start_time=stamp;
+		tt->wstart=wstamp;
+	}
+#ifdef PROFILE_STRICT
+	return;
+
+timeerr:profile_time_error=1;
+err:	profile_error=1;
 #endif
-#if !defined(_PTHREAD_H) || !defined(PROFILE_NO_TLS)
-		profile_thread=NULL;
+}
+
+#ifdef PROFILE_ALLOC
+
+static inline PROFILE_THREAD *__attribute__((no_instrument_function))
+	__attribute__((always_inline))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	profile_heap_thread(void)
+{
+	PROFILE_THREAD *tt;
+
+	if(__builtin_expect(!profile_heap_on,0))return NULL;
+	if(__builtin_expect(profile_stopped,0))return NULL;
+	if(__builtin_expect(profile_error,0))return NULL;
+#if defined(_PTHREAD_H) && defined(PROFILE_NO_TLS)
+	tt=pthread_getspecific(profile_key);
+#else
+	tt=profile_thread;
 #endif
+	if(__builtin_expect(!tt||!tt->stack_index,0))return NULL;
+	return tt;
+}
+
+static inline void __attribute__((no_instrument_function))
+	__attribute__((always_inline))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	profile_heap_add(PROFILE_THREAD *tt,unsigned long long start,
+		size_t size,int alloc)
+{
+	unsigned long long stamp;
+	PROFILE_STACK *p=&tt->stack[tt->stack_index];
+
+	profile_clock_read(tt,&stamp);
+	if(alloc)
+	{
+		p->allocs++;
+		p->abytes+=size;
 	}
-#ifdef PROFILE_STRICT
-	else if(__builtin_expect(profile_gettime(CLOCK_THREAD_CPUTIME_ID,
-		&tt->start_time),0))
+	else p->frees++;
+	p->atime+=stamp-start;
+	p->overhead+=profile_heap_overhead;
+}
+
+void *__attribute__((no_instrument_function))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	malloc(size_t size)
+{
+	void *ptr;
+	unsigned long long stamp;
+	PROFILE_THREAD *tt;
+
+	if(!(tt=profile_heap_thread()))return __libc_malloc(size);
+	profile_clock_read(tt,&stamp);
+	if(__builtin_expect((ptr=__libc_malloc(size))!=NULL,1))
+		profile_heap_add(tt,stamp,size,1);
+	return ptr;
+}
+
+void *__attribute__((no_instrument_function))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	calloc(size_t n,size_t size)
+{
+	void *ptr;
+	unsigned long long stamp;
+	PROFILE_THREAD *tt;
+
+	if(!(tt=profile_heap_thread()))return __libc_calloc(n,size);
+	profile_clock_read(tt,&stamp);
+	if(__builtin_expect((ptr=__libc_calloc(n,size))!=NULL,1))
+		profile_heap_add(tt,stamp,n*size,1);
+	return ptr;
+}
+
+void *__attribute__((no_instrument_function))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	realloc(void *ptr,size_t size)
+{
+	void *mem;
+	unsigned long long stamp;
+	PROFILE_THREAD *tt;
+
+	if(!(tt=profile_heap_thread()))return __libc_realloc(ptr,size);
+	profile_clock_read(tt,&stamp);
+	mem=__libc_realloc(ptr,size);
+	if(ptr&&!size)profile_heap_add(tt,stamp,0,0);
+	else if(__builtin_expect(mem!=NULL,1))profile_heap_add(tt,stamp,size,1);
+	return mem;
+}
+
+void *__attribute__((no_instrument_function))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	memalign(size_t alignment,size_t size)
+{
+	void *ptr;
+	unsigned long long stamp;
+	PROFILE_THREAD *tt;
+
+	if(!(tt=profile_heap_thread()))return __libc_memalign(alignment,size);
+	profile_clock_read(tt,&stamp);
+	if(__builtin_expect((ptr=__libc_memalign(alignment,size))!=NULL,1))
+		profile_heap_add(tt,stamp,size,1);
+	return ptr;
+}
+
+void *__attribute__((no_instrument_function))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	aligned_alloc(size_t alignment,size_t size)
+{
+	return memalign(alignment,size);
+}
+
+int __attribute__((no_instrument_function))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	posix_memalign(void **memptr,size_t alignment,size_t size)
+{
+	void *ptr;
+
+	if(!alignment||(alignment&(alignment-1))||alignment%sizeof(void *))
+		return EINVAL;
+	if(!(ptr=memalign(alignment,size)))return ENOMEM;
+	*memptr=ptr;
+	return 0;
+}
+
+void *__attribute__((no_instrument_function))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	valloc(size_t size)
+{
+	void *ptr;
+	unsigned long long stamp;
+	PROFILE_THREAD *tt;
+
+	if(!(tt=profile_heap_thread()))return __libc_valloc(size);
+	profile_clock_read(tt,&stamp);
+	if(__builtin_expect((ptr=__libc_valloc(size))!=NULL,1))
+		profile_heap_add(tt,stamp,size,1);
+	return ptr;
+}
+
+void *__attribute__((no_instrument_function))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	pvalloc(size_t size)
+{
+	void *ptr;
+	unsigned long long stamp;
+	PROFILE_THREAD *tt;
+
+	if(!(tt=profile_heap_thread()))return __libc_pvalloc(size);
+	profile_clock_read(tt,&stamp);
+	if(__builtin_expect((ptr=__libc_pvalloc(size))!=NULL,1))
+		profile_heap_add(tt,stamp,size,1);
+	return ptr;
+}
+
+void __attribute__((no_instrument_function))
+	__attribute__((no_sanitize_address))
+	__attribute__((no_sanitize_thread))
+	__attribute__((no_sanitize_undefined))
+	__attribute__((no_profile_instrument_function))
+	__attribute__((no_stack_limit))
+	__attribute__((optimize("no-stack-protector")))
+	__attribute__((optimize("omit-frame-pointer")))
+	free(void *ptr)
+{
+	unsigned long long stamp;
+	PROFILE_THREAD *tt;
+
+	if(!ptr||!(tt=profile_heap_thread()))
 	{
-timeerr:	profile_time_error=1;
-err:		profile_error=1;
+		__libc_free(ptr);
 		return;
 	}
-#else
-	else profile_gettime(CLOCK_THREAD_CPUTIME_ID,&tt->start_time);
-#endif
+	profile_clock_read(tt,&stamp);
+	__libc_free(ptr);
+	profile_heap_add(tt,stamp,0,0);
 }
 
 #endif
+
+#endif
@@ -0,0 +1,79 @@
+/*
+ * This file is part of the profiler project
+ *
+ * (C) 2019 Andreas Steinmetz, ast@domdv.de
+ * The contents of this file is licensed under the GPL version 2 or, at
+ * your choice, any later version of this license.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../profiler.h"
+
+#define LOOPS	1000000
+
+static volatile int start;
+
+static int __attribute__((noinline)) routine2(int value)
+{
+	return value*7+1;
+}
+
+static int __attribute__((noinline)) routine1(int value)
+{
+	int i;
+
+	for(i=0;i<LOOPS;i++)value=routine2(value);
+	return value;
+}
+
+static void *worker(void *arg)
+{
+	while(!start);
+	*((int *)arg)=routine1(*((int *)arg));
+	return NULL;
+}
+
+int main(int argc,char *argv[])
+{
+	int i;
+	int n;
+	int max;
+	char *mode;
+	unsigned long long ns;
+	struct timespec t1;
+	struct timespec t2;
+	pthread_t t[256];
+	int value[256];
+
+	if(argc<2||(max=atoi(argv[1]))<1)max=sysconf(_SC_NPROCESSORS_ONLN);
+	if(max>256)max=256;
+	if(!(mode=getenv("PROFILE_MODE")))mode="shared";
+
+	for(n=1;n<=max;n<<=1)
+	{
+		start=0;
+		for(i=0;i<n;i++)
+		{
+			value[i]=i;
+			if(pthread_create(&t[i],NULL,worker,&value[i]))
+			{
+				perror("pthread_create");
+				return 1;
+			}
+		}
+		clock_gettime(CLOCK_MONOTONIC,&t1);
+		start=1;
+		for(i=0;i<n;i++)pthread_join(t[i],NULL);
+		clock_gettime(CLOCK_MONOTONIC,&t2);
+
+		ns=(t2.tv_sec-t1.tv_sec)*1000000000ULL+t2.tv_nsec-t1.tv_nsec;
+		printf("%-8s %3d threads: %7.2f ns per call, %8.2f Mcalls/s\n",
+			mode,n,(double)ns/LOOPS,(double)n*LOOPS*1000.0/ns);
+	}
+
+	return 0;
+}